@@ -0,0 +1,50 @@
+#ifndef XOCZY_ALLOC_COUNTER_H
+#define XOCZY_ALLOC_COUNTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Licznik alokacji na stercie: zastępuje globalne operator new/delete,
+// więc liczy każdą alokację w programie (std::vector, std::string, std::function...).
+// Używany w benchmarkach, żeby sprawdzić, że pętla uczenia i wykrywania nie alokuje pamięci.
+// Nie trafia do programu xoczy: licznik to operacja atomowa przy każdej alokacji.
+// Plik dołączany tylko w jednej jednostce kompilacji (benchmark.cpp): zastępczych operator new/delete
+// nie można oznaczyć jako inline.
+
+inline std::atomic<size_t> allocation_count(0);
+
+inline size_t allocationCount() {
+    return allocation_count.load(std::memory_order_relaxed);
+}
+
+inline void* countedAllocate(std::size_t size, std::size_t alignment) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    void* p = nullptr;
+    if (alignment <= alignof(std::max_align_t)) {
+        p = std::malloc(size == 0 ? 1 : size);
+    } else if (posix_memalign(&p, alignment, size == 0 ? 1 : size) != 0) {
+        p = nullptr;
+    }
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(std::size_t size) { return countedAllocate(size, 0); }
+void* operator new[](std::size_t size) { return countedAllocate(size, 0); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return countedAllocate(size, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return countedAllocate(size, static_cast<std::size_t>(alignment)); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+#endif
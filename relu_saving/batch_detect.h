@@ -0,0 +1,272 @@
+#ifndef XOCZY_BATCH_DETECT_H
+#define XOCZY_BATCH_DETECT_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "dataset.h"
+#include "simple_nn.h"
+
+// Wykrywanie wsadowe: wiele obrazów ocenianych w jednym uruchomieniu programu.
+// Model wczytywany jest raz, obrazy zbierane w paczki i liczone przez forwardBatch
+// (mnożenie macierzy zamiast osobnego forward dla każdego obrazu).
+// Wyniki trafiają na wyjście w formacie CSV albo JSONL, po jednym wierszu na obraz.
+// Dla klasyfikatora (softmax) wypisywane jest top_k najbardziej prawdopodobnych klas:
+// w CSV po jednym wierszu na klasę, w JSONL jako lista "top".
+
+enum DetectFormat {
+    FORMAT_CSV,
+    FORMAT_JSONL,
+};
+
+// Lista obrazów z katalogu (pliki .txt, .pbm i .bits, także w podkatalogach, posortowane)
+// albo z pliku listy (w każdej linii ścieżka, opcjonalnie z etykietą jak w manifeście).
+inline bool collectImagePaths(const std::string& path, std::vector<std::string>& images) {
+    if (std::filesystem::is_directory(path)) {
+        std::error_code ec;
+        std::vector<std::filesystem::path> files;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(path, ec)) {
+            if (entry.is_regular_file() && isImageFile(entry.path())) {
+                files.push_back(entry.path());
+            }
+        }
+        if (ec) {
+            std::cerr << "Nie można odczytać katalogu " << path << std::endl;
+            return false;
+        }
+        std::sort(files.begin(), files.end());
+        for (const auto& file : files) {
+            images.push_back(file.string());
+        }
+        return true;
+    }
+
+    std::ifstream list(path);
+    if (!list.is_open()) {
+        std::cerr << "Nie można otworzyć listy obrazów " << path << std::endl;
+        return false;
+    }
+    std::filesystem::path base = std::filesystem::path(path).parent_path();
+    std::string line;
+    while (std::getline(list, line)) {
+        std::istringstream fields(line);
+        std::string image;
+        if (!(fields >> image) || image[0] == '#') {
+            continue;  // Pusta linia albo komentarz
+        }
+        std::filesystem::path image_path(image);
+        if (image_path.is_relative()) {
+            image_path = base / image_path;
+        }
+        images.push_back(image_path.string());
+    }
+    return true;
+}
+
+// Zbiera obrazy w paczki, liczy je siecią i wypisuje wyniki.
+// Net to sieć z forwardBatch i topKBatch na liczbach double: SimpleNN albo QuantizedNN (--int8).
+template <typename Net>
+class BasicBatchDetector {
+public:
+    BasicBatchDetector(Net& nn, int batch_size, DetectFormat format, std::ostream& out, int top_k = 1)
+        : nn(nn), batch_size(std::max(1, batch_size)), format(format), out(out),
+          classifier(nn.outputActivation() == OUTPUT_SOFTMAX), top_k(std::max(1, std::min(top_k, nn.outputSize()))),
+          inputs(static_cast<size_t>(this->batch_size) * nn.inputSize()),
+          outputs(static_cast<size_t>(this->batch_size) * nn.outputSize()),
+          top(classifier ? static_cast<size_t>(this->batch_size) * this->top_k : 0),
+          pending(0), scored(0), skipped(0), compute_seconds(0) {
+        out.precision(9);
+        if (format == FORMAT_CSV) {
+            out << (classifier ? "image,rank,class,score\n" : "image,score,detected\n");
+        }
+    }
+
+    // Dodaje obraz do paczki; pełna paczka jest od razu liczona i wypisywana
+    bool add(const std::string& name, const std::vector<double>& image) {
+        if (image.size() != static_cast<size_t>(nn.inputSize())) {
+            skip(name, "zły rozmiar");
+            return false;
+        }
+        std::copy(image.begin(), image.end(), inputs.begin() + pending * nn.inputSize());
+        names.push_back(name);
+        if (++pending == batch_size) {
+            flush();
+        }
+        return true;
+    }
+
+    // Dodaje obraz prosto ze zmapowanego pliku; piksele dekodowane wprost do miejsca w paczce
+    bool add(const std::string& name, const ImageView& image) {
+        if (image.pixelCount() != static_cast<size_t>(nn.inputSize())) {
+            skip(name, "zły rozmiar");
+            return false;
+        }
+        image.decode(&inputs[static_cast<size_t>(pending) * nn.inputSize()]);
+        names.push_back(name);
+        if (++pending == batch_size) {
+            flush();
+        }
+        return true;
+    }
+
+    // Obraz, którego nie dało się odczytać
+    void skip(const std::string& name, const std::string& reason) {
+        std::cerr << "Pominięto obraz " << name << " (" << reason << ")." << std::endl;
+        ++skipped;
+    }
+
+    // Liczy niepełną ostatnią paczkę
+    void finish() {
+        flush();
+        out.flush();
+    }
+
+    size_t scoredCount() const { return scored; }
+    size_t skippedCount() const { return skipped; }
+    double computeSeconds() const { return compute_seconds; }
+
+private:
+    Net& nn;
+    int batch_size;
+    DetectFormat format;
+    std::ostream& out;
+    bool classifier;                // Softmax: wypisywane najlepsze klasy zamiast wyniku detektora
+    int top_k;
+    AlignedBuffer<double> inputs;   // Paczka obrazów [batch_size x input]
+    AlignedBuffer<double> outputs;  // Wyniki paczki [batch_size x output]
+    std::vector<ClassScore> top;    // Najlepsze klasy paczki [batch_size x top_k]
+    std::vector<std::string> names; // Nazwy obrazów w bieżącej paczce
+    int pending;                    // Liczba obrazów w bieżącej paczce
+    size_t scored;
+    size_t skipped;
+    double compute_seconds;         // Czas samego liczenia sieci (bez odczytu plików)
+
+    void flush() {
+        if (pending == 0) {
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        if (classifier) {
+            nn.topKBatch(inputs.data(), pending, top_k, top.data());
+        } else {
+            nn.forwardBatch(inputs.data(), pending, outputs.data());
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        compute_seconds += elapsed.count();
+
+        int output_size = nn.outputSize();
+        for (int i = 0; i < pending; ++i) {
+            if (classifier) {
+                writeClasses(names[i], &top[static_cast<size_t>(i) * top_k]);
+            } else {
+                writeResult(names[i], &outputs[i * output_size]);
+            }
+        }
+        scored += pending;
+        pending = 0;
+        names.clear();
+    }
+
+    void writeResult(const std::string& name, const double* result) {
+        bool detected = result[0] >= 0.5;
+        if (format == FORMAT_CSV) {
+            out << csvField(name) << "," << result[0] << "," << (detected ? 1 : 0) << "\n";
+        } else {
+            out << "{\"image\":" << jsonString(name) << ",\"score\":" << result[0]
+                << ",\"detected\":" << (detected ? "true" : "false") << "}\n";
+        }
+    }
+
+    void writeClasses(const std::string& name, const ClassScore* classes) {
+        if (format == FORMAT_CSV) {
+            std::string field = csvField(name);
+            for (int r = 0; r < top_k; ++r) {
+                out << field << "," << r + 1 << "," << classes[r].label << "," << classes[r].score << "\n";
+            }
+        } else {
+            out << "{\"image\":" << jsonString(name) << ",\"top\":[";
+            for (int r = 0; r < top_k; ++r) {
+                out << (r ? "," : "") << "{\"class\":" << classes[r].label << ",\"score\":" << classes[r].score << "}";
+            }
+            out << "]}\n";
+        }
+    }
+
+    // Pole CSV w cudzysłowie, gdy zawiera przecinek, cudzysłów albo koniec linii
+    static std::string csvField(const std::string& text) {
+        if (text.find_first_of(",\"\n\r") == std::string::npos) {
+            return text;
+        }
+        std::string quoted = "\"";
+        for (char c : text) {
+            if (c == '"') {
+                quoted += '"';
+            }
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    static std::string jsonString(const std::string& text) {
+        std::string quoted = "\"";
+        for (unsigned char c : text) {
+            if (c == '"' || c == '\\') {
+                quoted += '\\';
+                quoted += c;
+            } else if (c < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                quoted += escaped;
+            } else {
+                quoted += c;
+            }
+        }
+        return quoted + "\"";
+    }
+};
+
+using BatchDetector = BasicBatchDetector<SimpleNN>;
+
+// Czyta strumień obrazów zapisanych jeden za drugim (np. połączone pliki .txt).
+// Każde kolejne image_size znaków '0'/'1' to jeden obraz, pozostałe znaki są pomijane.
+// Obrazy nazywane są "nazwa_strumienia:numer" (numeracja od 0); niepełny ostatni obraz liczony jest jako pominięty.
+template <typename Net>
+void detectStream(std::istream& in, const std::string& stream_name, size_t image_size, BasicBatchDetector<Net>& detector) {
+    std::vector<double> image;
+    image.reserve(image_size);
+    size_t index = 0;
+    char buffer[4096];
+    while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0) {
+        std::streamsize count = in.gcount();
+        for (std::streamsize i = 0; i < count; ++i) {
+            if (buffer[i] == '0' || buffer[i] == '1') {
+                image.push_back(buffer[i] - '0');
+                if (image.size() == image_size) {
+                    detector.add(stream_name + ":" + std::to_string(index++), image);
+                    image.clear();
+                }
+            }
+        }
+    }
+    if (!image.empty()) {
+        detector.skip(stream_name + ":" + std::to_string(index), "niepełny obraz, " + std::to_string(image.size()) + " pikseli");
+    }
+}
+
+// Wypisuje podsumowanie na stderr, żeby nie mieszać go z wynikami na stdout
+template <typename Net>
+void reportDetectionSpeed(const BasicBatchDetector<Net>& detector, double total_seconds) {
+    size_t images = detector.scoredCount();
+    std::cerr << "Ocenione obrazy: " << images << ", pominięte: " << detector.skippedCount() << std::endl;
+    std::cerr << "Czas: " << total_seconds << " s, " << images / std::max(total_seconds, 1e-9) << " obrazów/s"
+              << " (sama sieć: " << images / std::max(detector.computeSeconds(), 1e-9) << " obrazów/s)" << std::endl;
+}
+
+#endif
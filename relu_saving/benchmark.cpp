@@ -0,0 +1,501 @@
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "alloc_counter.h"
+#include "dataset.h"
+#include "image_file.h"
+#include "kernels.h"
+#include "quantized.h"
+#include "random.h"
+#include "simple_nn.h"
+#include "sparse.h"
+#include "trainer.h"
+
+// Mikrobenchmarki sieci (Google Benchmark).
+//
+//   xoczy_bench --benchmark_out=baseline.json --benchmark_out_format=json   zapis wyników bazowych
+//   xoczy_bench --baseline baseline.json [--max-regression 0.10]            porównanie z zapisanymi
+//   xoczy_bench --benchmark_filter=Allocations                               same sprawdzenia alokacji
+//
+// Przy porównaniu każdy benchmark wolniejszy od bazowego o więcej niż max-regression (czas CPU)
+// jest zgłaszany, a program kończy się kodem 1.
+
+// Rozmiary sieci: wejścia 100 -> 10 000, neurony ukryte 15 -> 4 096
+const std::vector<int64_t> INPUT_SIZES = {100, 1000, 10000};
+const std::vector<int64_t> HIDDEN_SIZES = {15, 256, 4096};
+
+// Losowy rzadki obraz binarny (ok. 20% zapalonych pikseli)
+std::vector<double> randomImage(int size, uint64_t stream) {
+    Xoshiro256 random(DEFAULT_SEED, stream);
+    std::vector<double> image(size);
+    for (double& pixel : image) {
+        pixel = (random.next() % 5 == 0) ? 1.0 : 0.0;
+    }
+    return image;
+}
+
+Dataset randomDataset(int samples, int input_size) {
+    Dataset data;
+    for (int i = 0; i < samples; ++i) {
+        data.add(randomImage(input_size, i), {static_cast<double>(i % 2)});
+    }
+    return data;
+}
+
+std::string temporaryFile(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// Liczba mnożeń z dodawaniem w jednym forward (do licznika FLOP/s)
+double forwardFlops(int input_size, int hidden_size) {
+    return 2.0 * (static_cast<double>(input_size) * hidden_size + hidden_size);
+}
+
+// Szerokość prostokątnego obrazu size pikseli: największy dzielnik nie większy od pierwiastka
+int imageWidth(int size) {
+    int width = static_cast<int>(std::sqrt(size));
+    while (size % width != 0) {
+        --width;
+    }
+    return width;
+}
+
+// Zapisuje losowy obraz w formacie ImageFormat; zwraca rozmiar pliku w bajtach
+size_t writeImage(const std::string& filename, int size, ImageFormat format) {
+    int width = imageWidth(size);
+    int height = size / width;
+    std::vector<double> image = randomImage(size, 0);
+    std::ofstream file(filename, std::ios::binary);
+    if (format == IMAGE_TEXT || format == IMAGE_PBM_PLAIN) {
+        if (format == IMAGE_PBM_PLAIN) {
+            file << "P1\n" << width << " " << height << "\n";
+        }
+        for (int i = 0; i < size; ++i) {
+            file << static_cast<int>(image[i]) << ((i + 1) % width == 0 ? "\n" : "");
+        }
+    } else {
+        if (format == IMAGE_PBM_RAW) {
+            file << "P4\n" << width << " " << height << "\n";
+        } else {
+            width = size;  // .bits: wszystkie piksele w jednym ciągu bitów
+            height = 1;
+        }
+        for (int y = 0; y < height; ++y) {
+            std::vector<char> row((width + 7) / 8, 0);
+            for (int x = 0; x < width; ++x) {
+                row[x / 8] |= static_cast<char>(static_cast<int>(image[y * width + x]) << (7 - x % 8));
+            }
+            file.write(row.data(), row.size());
+        }
+    }
+    return static_cast<size_t>(file.tellp());
+}
+
+void BM_ReadImage(benchmark::State& state) {
+    int size = state.range(0);
+    std::string filename = temporaryFile("xoczy_bench_image.txt");
+    size_t bytes = writeImage(filename, size, IMAGE_TEXT);
+    for (auto _ : state) {
+        std::vector<double> image = readImage(filename);
+        benchmark::DoNotOptimize(image.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * bytes);
+    std::filesystem::remove(filename);
+}
+BENCHMARK(BM_ReadImage)->Arg(100)->Arg(1000)->Arg(10000);
+
+// Jeden ImageFile dla kolejnych plików i dekodowanie wprost do gotowego bufora, jak przy wczytywaniu zbioru.
+// Drugi argument to ImageFormat: 0 tekst, 1 P1, 2 P4, 3 .bits.
+void BM_ImageFile(benchmark::State& state) {
+    int size = state.range(0);
+    ImageFormat format = static_cast<ImageFormat>(state.range(1));
+    const char* extensions[] = {".txt", ".pbm", ".pbm", ".bits"};
+    std::string filename = temporaryFile(std::string("xoczy_bench_image") + extensions[format]);
+    size_t bytes = writeImage(filename, size, format);
+    ImageFile file;
+    AlignedBuffer<double> pixels(size);
+    for (auto _ : state) {
+        if (!file.open(filename, size)) {
+            state.SkipWithError(file.error().c_str());
+            break;
+        }
+        file.view().decode(pixels.data());
+        benchmark::DoNotOptimize(pixels.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * bytes);
+    std::filesystem::remove(filename);
+}
+BENCHMARK(BM_ImageFile)->ArgsProduct({{100, 10000, 1000000}, {IMAGE_TEXT, IMAGE_PBM_PLAIN, IMAGE_PBM_RAW, IMAGE_BITS}});
+
+void BM_Forward(benchmark::State& state) {
+    int input_size = state.range(0);
+    int hidden_size = state.range(1);
+    SimpleNN nn(input_size, hidden_size, 1);
+    std::vector<double> image = randomImage(input_size, 0);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(nn.forward(image)[0]);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["FLOP/s"] = benchmark::Counter(forwardFlops(input_size, hidden_size) * state.iterations(), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_Forward)->ArgsProduct({INPUT_SIZES, HIDDEN_SIZES});
+
+void BM_ForwardBatch(benchmark::State& state) {
+    int input_size = state.range(0);
+    int hidden_size = state.range(1);
+    const int batch = 64;
+    SimpleNN nn(input_size, hidden_size, 1);
+    Dataset data = randomDataset(batch, input_size);
+    std::vector<double> outputs(batch);
+    for (auto _ : state) {
+        nn.forwardBatch(data.sample(0), batch, outputs.data());
+        benchmark::DoNotOptimize(outputs.data());
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+    state.counters["FLOP/s"] = benchmark::Counter(forwardFlops(input_size, hidden_size) * batch * state.iterations(), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ForwardBatch)->ArgsProduct({INPUT_SIZES, HIDDEN_SIZES});
+
+// Paczka obrazów siecią int8 (--int8 przy --detect i --serve); porównanie z BM_ForwardBatch
+void BM_QuantizedForwardBatch(benchmark::State& state) {
+    int input_size = state.range(0);
+    int hidden_size = state.range(1);
+    const int batch = 64;
+    SimpleNN nn(input_size, hidden_size, 1);
+    Dataset data = randomDataset(batch, input_size);
+    QuantizedNN quantized(nn, data);
+    std::vector<double> outputs(batch);
+    for (auto _ : state) {
+        quantized.forwardBatch(data.sample(0), batch, outputs.data());
+        benchmark::DoNotOptimize(outputs.data());
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_QuantizedForwardBatch)->ArgsProduct({INPUT_SIZES, HIDDEN_SIZES});
+
+// Forward sieci rzadkiej po przycięciu ułamka range(1)/100 wag; porównanie z BM_Forward o tych samych rozmiarach
+void BM_SparseForward(benchmark::State& state) {
+    int input_size = state.range(0);
+    int hidden_size = state.range(1);
+    SimpleNN nn(input_size, hidden_size, 1);
+    Dataset data = randomDataset(64, input_size);
+    pruneNetwork(nn, state.range(2) / 100.0, data);
+    SparseNN<double> sparse(nn);
+    std::vector<double> image = randomImage(input_size, 0);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sparse.forward(image)[0]);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["live"] = sparse.liveHidden();
+    state.counters["block"] = sparse.blockSize();
+}
+BENCHMARK(BM_SparseForward)->ArgsProduct({{100, 1000}, HIDDEN_SIZES, {50, 90, 99}});
+
+void BM_Train(benchmark::State& state) {
+    int input_size = state.range(0);
+    int hidden_size = state.range(1);
+    SimpleNN nn(input_size, hidden_size, 1);
+    std::vector<double> image = randomImage(input_size, 0);
+    std::vector<double> label = {1.0};
+    for (auto _ : state) {
+        nn.train(image, label, 0.001);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Train)->ArgsProduct({INPUT_SIZES, HIDDEN_SIZES});
+
+void BM_TrainBatch(benchmark::State& state) {
+    int input_size = state.range(0);
+    int hidden_size = state.range(1);
+    const int batch = 32;
+    SimpleNN nn(input_size, hidden_size, 1);
+    Dataset data = randomDataset(batch, input_size);
+    for (auto _ : state) {
+        nn.trainBatch(data.sample(0), data.label(0), batch, 0.001);
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_TrainBatch)->ArgsProduct({INPUT_SIZES, HIDDEN_SIZES});
+
+void BM_SaveWeights(benchmark::State& state) {
+    SimpleNN nn(state.range(0), state.range(1), 1);
+    std::string filename = temporaryFile("xoczy_bench_weights.txt");
+    for (auto _ : state) {
+        nn.saveWeights(filename);
+    }
+    state.SetItemsProcessed(state.iterations() * nn.parameterCount());
+    std::filesystem::remove(filename);
+}
+BENCHMARK(BM_SaveWeights)->Args({100, 30})->Args({1000, 256})->Args({10000, 256})->Unit(benchmark::kMillisecond);
+
+void BM_LoadWeights(benchmark::State& state) {
+    SimpleNN nn(state.range(0), state.range(1), 1);
+    std::string filename = temporaryFile("xoczy_bench_weights.txt");
+    nn.saveWeights(filename);
+    for (auto _ : state) {
+        if (!nn.loadWeights(filename)) {
+            state.SkipWithError("loadWeights failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * nn.parameterCount());
+    std::filesystem::remove(filename);
+}
+BENCHMARK(BM_LoadWeights)->Args({100, 30})->Args({1000, 256})->Args({10000, 256})->Unit(benchmark::kMillisecond);
+
+// Cała epoka jak w main(): każda próbka po kolei przez train (trzeci argument 1)
+// albo paczkami po 32 przez ParallelTrainer na jednym wątku (trzeci argument 32)
+void BM_Epoch(benchmark::State& state) {
+    int input_size = state.range(0);
+    int hidden_size = state.range(1);
+    int batch = state.range(2);
+    Dataset data = randomDataset(1024, input_size);
+    SimpleNN nn(input_size, hidden_size, 1);
+    ParallelTrainer trainer(nn, 1);
+    for (auto _ : state) {
+        if (batch == 1) {
+            for (size_t i = 0; i < data.size(); ++i) {
+                nn.train(data.sample(i), data.label(i), 0.001);
+            }
+        } else {
+            trainer.trainEpoch(data, batch, 0.001);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_Epoch)->ArgsProduct({{100, 1000}, {15, 256}, {1, 32}})->Unit(benchmark::kMillisecond);
+
+// Sprawdzenie, że pętle wykrywania i uczenia nie alokują pamięci po pierwszym przebiegu.
+// Licznik z alloc_counter.h zastępuje operator new tylko w xoczy_bench, nie w programie xoczy.
+// Argument: 0 forward, 1 forwardBatch, 2 train, 3 trainBatch, 4 ParallelTrainer (2 wątki).
+// Alokacja w pętli kończy benchmark błędem, a cały program kodem 1.
+const char* const ALLOCATION_LOOPS[] = {"forward", "forwardBatch", "train", "trainBatch", "ParallelTrainer"};
+int allocation_failures = 0;
+
+void BM_SteadyStateAllocations(benchmark::State& state) {
+    int loop = state.range(0);
+    const int batch = 32;
+    Dataset data = randomDataset(256, 100);
+    SimpleNN nn(100, 30, 1);
+    ParallelTrainer trainer(nn, 2);
+    std::vector<double> outputs(data.size());
+    auto pass = [&] {
+        for (size_t i = 0; i < data.size(); i += (loop == 0 || loop == 2) ? 1 : batch) {
+            int count = static_cast<int>(std::min<size_t>(batch, data.size() - i));
+            switch (loop) {
+            case 0: nn.forward(data.sample(i), &outputs[i]); break;
+            case 1: nn.forwardBatch(data.sample(i), count, &outputs[i]); break;
+            case 2: nn.train(data.sample(i), data.label(i), 0.001); break;
+            case 3: nn.trainBatch(data.sample(i), data.label(i), count, 0.001); break;
+            default: trainer.trainEpoch(data, batch, 0.001); return;
+            }
+        }
+    };
+    pass();  // Rozgrzewka: bufory sieci i wątków przydzielane przy pierwszym użyciu
+    size_t before = allocationCount();
+    for (auto _ : state) {
+        pass();
+    }
+    size_t allocations = allocationCount() - before;
+    state.SetLabel(ALLOCATION_LOOPS[loop]);
+    state.SetItemsProcessed(state.iterations() * data.size());
+    if (allocations > 0) {
+        ++allocation_failures;
+        state.SkipWithError((std::to_string(allocations) + " alokacji po rozgrzewce").c_str());
+    }
+}
+BENCHMARK(BM_SteadyStateAllocations)->DenseRange(0, 4);
+
+// Funkcje SIMD osobno dla każdego zestawu (0 = scalar, 1 = avx2, 2 = avx512)
+const char* const KERNEL_NAMES[] = {"scalar", "avx2", "avx512"};
+
+void BM_Dot(benchmark::State& state) {
+    const char* name = KERNEL_NAMES[state.range(0)];
+    int n = state.range(1);
+    if (!selectKernels(name)) {
+        state.SkipWithError("kernel set not supported by this CPU");
+        return;
+    }
+    std::vector<double> a = randomImage(n, 0);
+    std::vector<double> b = randomImage(n, 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(kernels<double>().dot(a.data(), b.data(), n));
+    }
+    state.SetLabel(name);
+    state.SetItemsProcessed(state.iterations() * n);
+    selectKernels(detectKernels());
+}
+BENCHMARK(BM_Dot)->ArgsProduct({{0, 1, 2}, {100, 10000}});
+
+void BM_Axpy(benchmark::State& state) {
+    const char* name = KERNEL_NAMES[state.range(0)];
+    int n = state.range(1);
+    if (!selectKernels(name)) {
+        state.SkipWithError("kernel set not supported by this CPU");
+        return;
+    }
+    std::vector<double> x = randomImage(n, 0);
+    std::vector<double> y(n, 0.0);
+    for (auto _ : state) {
+        kernels<double>().axpy(1e-9, x.data(), y.data(), n);
+        benchmark::DoNotOptimize(y.data());
+    }
+    state.SetLabel(name);
+    state.SetItemsProcessed(state.iterations() * n);
+    selectKernels(detectKernels());
+}
+BENCHMARK(BM_Axpy)->ArgsProduct({{0, 1, 2}, {100, 10000}});
+
+// Zbiera czasy CPU wszystkich benchmarków (w nanosekundach) do porównania z bazą
+class CollectingReporter : public benchmark::ConsoleReporter {
+public:
+    explicit CollectingReporter(OutputOptions options) : ConsoleReporter(options) {}
+
+    void ReportRuns(const std::vector<Run>& runs) override {
+        for (const Run& run : runs) {
+            if (!run.error_occurred) {
+                cpu_times[run.benchmark_name()] = run.GetAdjustedCPUTime() * nanosecondsPer(run.time_unit);
+            }
+        }
+        ConsoleReporter::ReportRuns(runs);
+    }
+
+    std::map<std::string, double> cpu_times;
+
+    static double nanosecondsPer(benchmark::TimeUnit unit) {
+        switch (unit) {
+        case benchmark::kSecond: return 1e9;
+        case benchmark::kMillisecond: return 1e6;
+        case benchmark::kMicrosecond: return 1e3;
+        default: return 1;
+        }
+    }
+};
+
+// Pole liczbowe albo tekstowe "key": wartość z fragmentu JSON
+std::string jsonField(const std::string& object, const std::string& key) {
+    std::string pattern = "\"" + key + "\":";
+    size_t pos = object.find(pattern);
+    if (pos == std::string::npos) {
+        return "";
+    }
+    pos = object.find_first_not_of(" \t\n", pos + pattern.size());
+    if (pos == std::string::npos) {
+        return "";
+    }
+    if (object[pos] == '"') {
+        size_t end = object.find('"', pos + 1);
+        return object.substr(pos + 1, end - pos - 1);
+    }
+    size_t end = object.find_first_of(",}\n", pos);
+    return object.substr(pos, end - pos);
+}
+
+// Czasy CPU (ns) z pliku JSON zapisanego przez --benchmark_out_format=json
+bool loadBaseline(const std::string& filename, std::map<std::string, double>& cpu_times) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Nie można otworzyć pliku bazowego " << filename << std::endl;
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string json = buffer.str();
+
+    size_t pos = json.find("\"benchmarks\"");
+    while (pos != std::string::npos && (pos = json.find('{', pos)) != std::string::npos) {
+        size_t end = json.find('}', pos);
+        if (end == std::string::npos) {
+            break;
+        }
+        std::string object = json.substr(pos, end - pos + 1);
+        std::string name = jsonField(object, "name");
+        std::string time = jsonField(object, "cpu_time");
+        std::string unit = jsonField(object, "time_unit");
+        if (!name.empty() && !time.empty() && jsonField(object, "error_occurred") != "true") {
+            double scale = unit == "s" ? 1e9 : unit == "ms" ? 1e6 : unit == "us" ? 1e3 : 1;
+            cpu_times[name] = std::atof(time.c_str()) * scale;
+        }
+        pos = end + 1;
+    }
+    if (cpu_times.empty()) {
+        std::cerr << "Plik " << filename << " nie zawiera wyników benchmarków." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Porównuje wyniki z bazą; zwraca liczbę regresji
+int compareWithBaseline(const std::map<std::string, double>& baseline, const std::map<std::string, double>& current, double max_regression) {
+    int regressions = 0;
+    std::cout << "\nPorównanie z bazą (czas CPU, dopuszczalne spowolnienie " << max_regression * 100 << "%):" << std::endl;
+    for (const auto& [name, time] : current) {
+        auto it = baseline.find(name);
+        if (it == baseline.end()) {
+            continue;
+        }
+        double change = time / it->second - 1;
+        bool regression = change > max_regression;
+        regressions += regression;
+        char line[256];
+        std::snprintf(line, sizeof(line), "%-50s %+7.1f%%%s", name.c_str(), change * 100, regression ? "  REGRESJA" : "");
+        std::cout << line << std::endl;
+    }
+    std::cout << (regressions == 0 ? "Brak regresji." : std::to_string(regressions) + " regresji.") << std::endl;
+    return regressions;
+}
+
+int main(int argc, char** argv) {
+    // Własne argumenty usuwane przed przekazaniem reszty do Google Benchmark
+    std::string baseline_path;
+    double max_regression = 0.10;
+    std::vector<char*> args;
+    for (int a = 0; a < argc; ++a) {
+        if (std::strcmp(argv[a], "--baseline") == 0 && a + 1 < argc) {
+            baseline_path = argv[++a];
+        } else if (std::strcmp(argv[a], "--max-regression") == 0 && a + 1 < argc) {
+            max_regression = std::atof(argv[++a]);
+        } else {
+            args.push_back(argv[a]);
+        }
+    }
+    int benchmark_argc = static_cast<int>(args.size());
+    benchmark::Initialize(&benchmark_argc, args.data());
+    if (benchmark::ReportUnrecognizedArguments(benchmark_argc, args.data())) {
+        return 1;
+    }
+
+    std::map<std::string, double> baseline;
+    if (!baseline_path.empty() && !loadBaseline(baseline_path, baseline)) {
+        return 1;
+    }
+
+    std::cout << "Funkcje wektorowe: " << kernels().name << std::endl;
+    // Kolory tylko na terminalu (własny reporter nie dostaje --benchmark_color)
+    CollectingReporter reporter(isatty(STDOUT_FILENO) ? benchmark::ConsoleReporter::OO_Defaults : benchmark::ConsoleReporter::OO_Tabular);
+    benchmark::RunSpecifiedBenchmarks(&reporter);
+    benchmark::Shutdown();
+
+    if (allocation_failures > 0) {
+        std::cerr << "Pętle alokujące pamięć po rozgrzewce: " << allocation_failures << std::endl;
+        return 1;
+    }
+    if (!baseline.empty() && compareWithBaseline(baseline, reporter.cpu_times, max_regression) > 0) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,75 @@
+#ifndef XOCZY_BIT_IMAGE_H
+#define XOCZY_BIT_IMAGE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Obraz binarny zapisany jako spakowany zbiór bitów: jeden piksel = jeden bit.
+// Obraz 10x10 mieści się w dwóch słowach 64-bitowych (16 bajtów zamiast 800 bajtów w std::vector<double>).
+class BitImage {
+public:
+    BitImage() : pixel_count(0) {}
+
+    explicit BitImage(size_t pixels) : pixel_count(pixels), words((pixels + 63) / 64, 0) {}
+
+    // Pakuje obraz z postaci gęstej (wartości 0.0 / 1.0)
+    static BitImage fromDense(const std::vector<double>& image) {
+        BitImage bits(image.size());
+        for (size_t i = 0; i < image.size(); ++i) {
+            if (image[i] != 0.0) {
+                bits.set(i);
+            }
+        }
+        return bits;
+    }
+
+    void set(size_t i) { words[i / 64] |= uint64_t(1) << (i % 64); }
+    bool test(size_t i) const { return (words[i / 64] >> (i % 64)) & 1; }
+
+    size_t size() const { return pixel_count; }
+    bool empty() const { return pixel_count == 0; }
+
+    // Liczba zapalonych pikseli (popcount po wszystkich słowach)
+    size_t count() const {
+        size_t total = 0;
+        for (uint64_t word : words) {
+            total += __builtin_popcountll(word);
+        }
+        return total;
+    }
+
+    // Zapisuje do bufora indeksy zapalonych pikseli mniejsze niż limit; zwraca ich liczbę.
+    // Bufor musi mieć miejsce na limit elementów, więc obraz większy od sieci nie wyjdzie poza bufor.
+    size_t setBits(int* indices, size_t limit) const {
+        size_t n = 0;
+        size_t used = std::min(words.size(), (limit + 63) / 64);
+        for (size_t w = 0; w < used; ++w) {
+            uint64_t word = words[w];
+            if ((w + 1) * 64 > limit) {
+                word &= ~uint64_t(0) >> ((w + 1) * 64 - limit);  // Bez bitów o indeksach >= limit
+            }
+            while (word) {
+                indices[n++] = static_cast<int>(w * 64 + __builtin_ctzll(word));
+                word &= word - 1;  // Gasi najniższy zapalony bit
+            }
+        }
+        return n;
+    }
+
+    // Rozpakowuje obraz z powrotem do postaci gęstej
+    std::vector<double> toDense() const {
+        std::vector<double> image(pixel_count, 0.0);
+        for (size_t i = 0; i < pixel_count; ++i) {
+            image[i] = test(i) ? 1.0 : 0.0;
+        }
+        return image;
+    }
+
+private:
+    size_t pixel_count;           // Liczba pikseli obrazu
+    std::vector<uint64_t> words;  // Bity pikseli, piksel i w słowie i / 64
+};
+
+#endif
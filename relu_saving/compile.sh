@@ -13,7 +13,7 @@ fi
 echo "----Kompilacja programu----"
 
 # Kompilacja z przekierowaniem błędów do pliku error_log.txt
-g++ -o xoczy xoczy.cpp 2> error_log.txt
+g++ -O2 -pthread -o xoczy xoczy.cpp 2> error_log.txt
 
 # Sprawdzanie, czy plik error_log.txt jest pusty
 if [ -s error_log.txt ]; then
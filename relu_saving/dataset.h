@@ -0,0 +1,282 @@
+#ifndef XOCZY_DATASET_H
+#define XOCZY_DATASET_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "image_file.h"
+#include "random.h"
+
+// Alokator zwracający pamięć wyrównaną do linii cache (64 bajty),
+// dzięki czemu każda macierz próbek zaczyna się na granicy linii cache
+template <typename T, std::size_t Alignment = 64>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept {}
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* p, std::size_t) noexcept {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+};
+
+// Wektor wyrównany do 64 bajtów
+template <typename T>
+using AlignedBuffer = std::vector<T, AlignedAllocator<T>>;
+
+// Zbiór treningowy wczytany raz do pamięci.
+// Wszystkie obrazy leżą jeden za drugim w jednej wyrównanej macierzy
+// (wiersz = jedna próbka), etykiety w osobnej macierzy o szerokości label_size.
+// T to typ liczb w macierzy, taki sam jak typ wag uczonej sieci.
+template <typename T>
+class BasicDataset {
+public:
+    BasicDataset() : input_size(0), label_size(1) {}
+
+    // Dodaje jedną próbkę; pierwszy obraz ustala rozmiar wejścia (NxM pikseli)
+    bool add(const std::vector<double>& image, const std::vector<double>& label) {
+        if (image.empty()) {
+            return false;
+        }
+        if (input_size == 0) {
+            input_size = image.size();
+            label_size = label.size();
+        }
+        if (image.size() != input_size || label.size() != label_size) {
+            return false;
+        }
+        samples.insert(samples.end(), image.begin(), image.end());  // Konwersja do T przy kopiowaniu
+        labels.insert(labels.end(), label.begin(), label.end());
+        return true;
+    }
+
+    // Dodaje próbkę prosto ze zmapowanego pliku: piksele dekodowane od razu do nowego wiersza macierzy
+    bool add(const ImageView& image, const std::vector<double>& label) {
+        if (input_size == 0) {
+            input_size = image.pixelCount();
+            label_size = label.size();
+        }
+        if (image.pixelCount() != input_size || label.size() != label_size) {
+            return false;
+        }
+        size_t offset = samples.size();
+        samples.resize(offset + input_size);
+        image.decode(&samples[offset]);
+        labels.insert(labels.end(), label.begin(), label.end());
+        return true;
+    }
+
+    // Wczytuje obraz z pliku i dodaje go z pojedynczą etykietą
+    // Przy ustawionej liczbie klas etykieta to numer klasy, zapisywany jako wektor 0/1 (one-hot)
+    bool addFile(const std::string& filename, double label) {
+        ImageFile file;
+        return addFile(filename, label, file);
+    }
+
+    // Jak wyżej, ale przez podany ImageFile: funkcje wczytujące wiele plików przekazują jeden obiekt,
+    // więc bufor małych plików jest przydzielany raz na cały zbiór
+    bool addFile(const std::string& filename, double label, ImageFile& file) {
+        std::vector<double> target = {label};
+        if (classes > 0) {
+            int index = static_cast<int>(label);
+            if (index != label || index < 0 || index >= classes) {
+                std::cerr << "Pominięto obraz " << filename << " (etykieta " << label << " nie jest klasą 0-" << classes - 1 << ")." << std::endl;
+                return false;
+            }
+            target.assign(classes, 0.0);
+            target[index] = 1.0;
+        }
+        // Pierwszy obraz ustala rozmiar, każdy następny musi mieć tyle samo pikseli
+        if (!file.open(filename, input_size)) {
+            std::cerr << "Pominięto obraz " << filename << " (" << file.error() << ")." << std::endl;
+            return false;
+        }
+        bool ok = add(file.view(), target);
+        if (!ok) {
+            std::cerr << "Pominięto obraz " << filename << " (zły rozmiar etykiety)." << std::endl;
+        }
+        return ok;
+    }
+
+    // Wczytuje listę plików z odpowiadającymi im etykietami
+    bool loadFiles(const std::vector<std::string>& files, const std::vector<int>& expected) {
+        bool ok = files.size() == expected.size();
+        ImageFile image;
+        for (size_t i = 0; i < files.size() && i < expected.size(); ++i) {
+            ok = addFile(files[i], static_cast<double>(expected[i]), image) && ok;
+        }
+        return ok;
+    }
+
+    // Wczytuje manifest: każda linia to "ścieżka etykieta"; puste linie i '#' są pomijane.
+    // Ścieżki względne liczone są od katalogu, w którym leży manifest.
+    bool loadManifest(const std::string& manifest) {
+        std::ifstream file(manifest);
+        if (!file.is_open()) {
+            std::cerr << "Nie można otworzyć manifestu " << manifest << std::endl;
+            return false;
+        }
+        std::filesystem::path base = std::filesystem::path(manifest).parent_path();
+        bool ok = true;
+        ImageFile image;
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            std::istringstream fields(line);
+            std::string path;
+            double label;
+            if (!(fields >> path >> label)) {
+                std::cerr << "Błędna linia manifestu: " << line << std::endl;
+                ok = false;
+                continue;
+            }
+            std::filesystem::path image_path(path);
+            if (image_path.is_relative()) {
+                image_path = base / image_path;
+            }
+            ok = addFile(image_path.string(), label, image) && ok;
+        }
+        return ok;
+    }
+
+    // Wczytuje katalog, w którym każdy podkatalog nazywa się jak etykieta,
+    // np. dane/1/*.txt to obrazy z wzorem, dane/0/*.txt to obrazy bez wzoru
+    bool loadDirectory(const std::string& directory) {
+        std::error_code ec;
+        std::vector<std::filesystem::path> files;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, ec)) {
+            if (entry.is_regular_file() && isImageFile(entry.path())) {
+                files.push_back(entry.path());
+            }
+        }
+        if (ec) {
+            std::cerr << "Nie można odczytać katalogu " << directory << std::endl;
+            return false;
+        }
+        std::sort(files.begin(), files.end());  // Stała kolejność próbek niezależnie od systemu plików
+
+        bool ok = true;
+        ImageFile image;
+        for (const auto& path : files) {
+            char* end = nullptr;
+            std::string label_name = path.parent_path().filename().string();
+            double label = std::strtod(label_name.c_str(), &end);
+            if (end == label_name.c_str() || *end != '\0') {
+                std::cerr << "Pominięto " << path.string() << " (nazwa katalogu nie jest etykietą)." << std::endl;
+                ok = false;
+                continue;
+            }
+            ok = addFile(path.string(), label, image) && ok;
+        }
+        return ok;
+    }
+
+    // Wczytuje manifest albo katalog, zależnie od tego, na co wskazuje ścieżka
+    bool load(const std::string& path) {
+        if (std::filesystem::is_directory(path)) {
+            return loadDirectory(path);
+        }
+        return loadManifest(path);
+    }
+
+    // Przenosi losowo wybrany ułamek fraction próbek (co najmniej jedną, ale nigdy wszystkie)
+    // do zbioru validation; pozostałe próbki zachowują swoją kolejność
+    void split(double fraction, uint64_t seed, BasicDataset& validation) {
+        size_t count = size();
+        if (count < 2 || fraction <= 0) {
+            return;
+        }
+        size_t held_out = std::min(count - 1, std::max<size_t>(1, static_cast<size_t>(count * fraction + 0.5)));
+
+        // Losowa permutacja (Fisher-Yates); pierwsze held_out indeksy trafiają do walidacji
+        std::vector<size_t> order(count);
+        std::iota(order.begin(), order.end(), 0);
+        Xoshiro256 random(seed, 2);
+        for (size_t i = count - 1; i > 0; --i) {
+            std::swap(order[i], order[random.next() % (i + 1)]);
+        }
+        std::vector<bool> held(count, false);
+        for (size_t k = 0; k < held_out; ++k) {
+            held[order[k]] = true;
+        }
+
+        BasicDataset training;
+        training.classes = classes;
+        for (size_t i = 0; i < count; ++i) {
+            (held[i] ? validation : training).add(std::vector<double>(sample(i), sample(i) + input_size),
+                                                  std::vector<double>(label(i), label(i) + label_size));
+        }
+        *this = std::move(training);
+    }
+
+    // Etykiety wczytywanych dalej plików to numery klas 0..count-1 (0 = pojedyncza wartość jak dotąd)
+    void setClasses(int count) { classes = count; }
+
+    size_t size() const { return input_size == 0 ? 0 : samples.size() / input_size; }
+    size_t inputSize() const { return input_size; }
+    size_t labelSize() const { return label_size; }
+
+    // Wskaźnik na i-tą próbkę i jej etykietę w ciągłym bloku pamięci
+    const T* sample(size_t i) const { return samples.data() + i * input_size; }
+    const T* label(size_t i) const { return labels.data() + i * label_size; }
+    T* sample(size_t i) { return samples.data() + i * input_size; }
+    T* label(size_t i) { return labels.data() + i * label_size; }
+
+    // Ustawia liczbę i rozmiary próbek bez wczytywania, np. przed wypełnieniem próbkami
+    // generowanymi w pamięci. Przy tych samych lub mniejszych rozmiarach nie przydziela pamięci.
+    void reshape(size_t count, size_t inputs, size_t outputs) {
+        input_size = inputs;
+        label_size = outputs;
+        samples.resize(count * inputs);
+        labels.resize(count * outputs);
+    }
+
+    // Kopia zbioru w innym typie liczb (np. float do uczenia w pojedynczej precyzji)
+    template <typename U>
+    BasicDataset<U> convert() const {
+        BasicDataset<U> converted;
+        for (size_t i = 0; i < size(); ++i) {
+            converted.add(std::vector<double>(sample(i), sample(i) + input_size),
+                          std::vector<double>(label(i), label(i) + label_size));
+        }
+        return converted;
+    }
+
+private:
+    size_t input_size;     // Liczba pikseli w jednym obrazie
+    size_t label_size;     // Liczba wartości oczekiwanych na próbkę
+    int classes = 0;       // Liczba klas dla etykiet-numerów klas (0 = etykieta to wartość wyjścia)
+    AlignedBuffer<T> samples; // Macierz próbek [size() x input_size]
+    AlignedBuffer<T> labels;  // Macierz etykiet [size() x label_size]
+};
+
+using Dataset = BasicDataset<double>;
+
+#endif
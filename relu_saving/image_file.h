@@ -0,0 +1,426 @@
+#ifndef XOCZY_IMAGE_FILE_H
+#define XOCZY_IMAGE_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <filesystem>
+#include <immintrin.h>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "bit_image.h"
+#include "kernels.h"
+
+// Odczyt obrazów z plików zmapowanych w pamięć (mmap), bez std::getline i bez kopii w std::string.
+//
+// Obsługiwane formaty:
+//   tekst  - siatka znaków '0'/'1', jeden wiersz obrazu w linii (jak training1.txt)
+//   P1     - PBM tekstowy: "P1", szerokość, wysokość i piksele 0/1 (odstępy dowolne, '#' = komentarz w nagłówku)
+//   P4     - PBM binarny: "P4", szerokość, wysokość i wiersze bitów dopełnione do pełnego bajtu
+//   .bits  - same spakowane bity bez nagłówka, najstarszy bit bajtu pierwszy (jak w P4);
+//            liczbę pikseli wyznacza wejście sieci
+// W PBM 1 to piksel czarny, czyli zapalony, tak samo jak '1' w formacie tekstowym.
+//
+// Małe pliki (typowy obraz 10x10 ma 110 bajtów) są czytane jednym read() do bufora używanego
+// ponownie przy kolejnych plikach: mmap i munmap kosztują więcej niż samo skopiowanie kilku stron.
+//
+// ImageFile sprawdza cały plik przy otwarciu: niedozwolone znaki, wiersze różnej długości,
+// rozmiar niezgodny z nagłówkiem albo z wejściem sieci. Wynik to ImageView - widok na zmapowane
+// bajty, z którego piksele dekodowane są od razu tam, gdzie są potrzebne (wiersz macierzy próbek,
+// miejsce w paczce), bez pośredniego std::vector.
+
+enum ImageFormat {
+    IMAGE_TEXT,
+    IMAGE_PBM_PLAIN,  // P1
+    IMAGE_PBM_RAW,    // P4
+    IMAGE_BITS,       // .bits
+};
+
+// Pliki, które mogą być obrazami (w katalogach zbioru danych i wykrywania wsadowego)
+inline bool isImageFile(const std::filesystem::path& path) {
+    std::string extension = path.extension().string();
+    return extension == ".txt" || extension == ".pbm" || extension == ".bits";
+}
+
+// Długość początku text[0..n) złożonego tylko ze znaków '0' i '1'
+inline size_t binaryPrefixScalar(const char* text, size_t n) {
+    size_t i = 0;
+    while (i < n && (text[i] & 0xFE) == '0') {  // '0' = 0x30, '1' = 0x31
+        ++i;
+    }
+    return i;
+}
+
+// To samo po 32 bajty: jedno porównanie (bajt & 0xFE) == '0' na wektor, maska bitowa wskazuje pierwszy inny znak
+__attribute__((target("avx2")))
+inline size_t binaryPrefixAvx2(const char* text, size_t n) {
+    const __m256i mask = _mm256_set1_epi8(static_cast<char>(0xFE));
+    const __m256i zero = _mm256_set1_epi8('0');
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+        __m256i binary = _mm256_cmpeq_epi8(_mm256_and_si256(bytes, mask), zero);
+        uint32_t other = ~static_cast<uint32_t>(_mm256_movemask_epi8(binary));
+        if (other != 0) {
+            return i + __builtin_ctz(other);
+        }
+    }
+    return i + binaryPrefixScalar(text + i, n - i);
+}
+
+// Wersja wektorowa, o ile procesor ma AVX2, a --kernels nie wymusza wersji skalarnej
+inline size_t binaryPrefix(const char* text, size_t n) {
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if (avx2 && activeKernels<double>() != &KernelSets<double>::scalar) {
+        return binaryPrefixAvx2(text, n);
+    }
+    return binaryPrefixScalar(text, n);
+}
+
+inline bool isPbmSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+// Obraz w zmapowanym pliku: wskaźnik do pikseli i opis ich układu, bez własnej kopii.
+// Ważny, dopóki otwarty jest ImageFile, z którego pochodzi.
+class ImageView {
+public:
+    ImageFormat format() const { return image_format; }
+    size_t width() const { return image_width; }
+    size_t height() const { return image_height; }
+    size_t pixelCount() const { return image_width * image_height; }
+
+    // Zapisuje pixelCount() wartości 0/1 do pixels (np. wiersz macierzy próbek)
+    template <typename T>
+    void decode(T* pixels) const {
+        visit([pixels](size_t i, int value) { pixels[i] = static_cast<T>(value); });
+    }
+
+    // Obraz od razu w postaci spakowanej, dla forward na bitach
+    BitImage toBits() const {
+        BitImage bits(pixelCount());
+        visit([&bits](size_t i, int value) {
+            if (value) {
+                bits.set(i);
+            }
+        });
+        return bits;
+    }
+
+private:
+    friend class ImageFile;
+
+    ImageFormat image_format = IMAGE_TEXT;
+    const char* data = nullptr;  // Pierwszy piksel (pierwszy bajt rastra)
+    size_t length = 0;           // Bajty od data do końca pikseli
+    size_t image_width = 0;
+    size_t image_height = 0;
+    size_t stride = 0;           // Tekst i P4: odstęp w bajtach między początkami kolejnych wierszy
+
+    // Woła pixel(i, wartość) dla kolejnych pikseli, wiersz po wierszu
+    template <typename Pixel>
+    void visit(Pixel pixel) const {
+        switch (image_format) {
+        case IMAGE_TEXT:
+            for (size_t y = 0; y < image_height; ++y) {
+                const char* row = data + y * stride;
+                for (size_t x = 0; x < image_width; ++x) {
+                    pixel(y * image_width + x, row[x] - '0');
+                }
+            }
+            break;
+        case IMAGE_PBM_PLAIN: {
+            // Ciągi cyfr rozdzielone odstępami; poprawność sprawdziło już ImageFile
+            size_t i = 0;
+            size_t p = 0;
+            while (p < length) {
+                size_t end = p + binaryPrefix(data + p, length - p);
+                for (; p < end; ++p) {
+                    pixel(i++, data[p] - '0');
+                }
+                while (p < length && isPbmSpace(data[p])) {
+                    ++p;
+                }
+            }
+            break;
+        }
+        case IMAGE_PBM_RAW:
+        case IMAGE_BITS:
+            for (size_t y = 0; y < image_height; ++y) {
+                const unsigned char* row = reinterpret_cast<const unsigned char*>(data + y * stride);
+                size_t first = y * image_width;
+                size_t x = 0;
+                for (; x + 8 <= image_width; x += 8) {
+                    unsigned bits = row[x >> 3];  // Pełny bajt: 8 pikseli bez liczenia pozycji bitu
+                    for (int k = 0; k < 8; ++k) {
+                        pixel(first + x + k, (bits >> (7 - k)) & 1);
+                    }
+                }
+                for (; x < image_width; ++x) {
+                    pixel(first + x, (row[x >> 3] >> (7 - (x & 7))) & 1);
+                }
+            }
+            break;
+        }
+    }
+};
+
+// Plik obrazu zmapowany (mały: wczytany do bufora) tylko do odczytu; widok jest ważny
+// do close() albo następnego open(). Jeden obiekt może kolejno otwierać wiele plików
+// (np. cały katalog zbioru danych), wtedy bufor małych plików jest przydzielany tylko raz.
+class ImageFile {
+public:
+    // Pliki do tego rozmiaru są czytane do bufora, większe mapowane
+    static const size_t READ_LIMIT = 64 * 1024;
+
+    ImageFile() : mapped(nullptr), size(0) {}
+    ~ImageFile() { close(); }
+
+    ImageFile(const ImageFile&) = delete;
+    ImageFile& operator=(const ImageFile&) = delete;
+
+    // Mapuje i sprawdza plik. expected_pixels > 0 to liczba pikseli, jakiej oczekuje sieć
+    // (dla .bits jedyne źródło rozmiaru). Przy błędzie przyczyna jest w error().
+    bool open(const std::string& filename, size_t expected_pixels = 0) {
+        close();
+        message.clear();
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return fail("nie można otworzyć pliku");
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            ::close(fd);
+            return fail("pusty plik");
+        }
+        size = info.st_size;
+        const char* text;
+        if (size <= READ_LIMIT) {
+            buffer.resize(size);
+            ssize_t count = ::read(fd, buffer.data(), size);
+            ::close(fd);
+            if (count != static_cast<ssize_t>(size)) {
+                return fail("nie można odczytać pliku");
+            }
+            text = buffer.data();
+        } else {
+            // MAP_POPULATE: strony wczytane od razu, bez osobnego błędu strony na każde 4 KB
+            mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+            ::close(fd);  // Mapowanie pozostaje ważne po zamknięciu deskryptora
+            if (mapped == MAP_FAILED) {
+                mapped = nullptr;
+                return fail("nie można zmapować pliku");
+            }
+            text = static_cast<const char*>(mapped);
+        }
+
+        bool ok;
+        if (std::filesystem::path(filename).extension() == ".bits") {
+            ok = parseBits(text, expected_pixels);
+        } else if (size >= 2 && text[0] == 'P' && text[1] == '1') {
+            ok = parsePbm(text, IMAGE_PBM_PLAIN);
+        } else if (size >= 2 && text[0] == 'P' && text[1] == '4') {
+            ok = parsePbm(text, IMAGE_PBM_RAW);
+        } else {
+            ok = parseText(text);
+        }
+        if (ok && expected_pixels > 0 && image.pixelCount() != expected_pixels) {
+            ok = fail("obraz ma " + std::to_string(image.pixelCount()) + " pikseli zamiast " + std::to_string(expected_pixels));
+        }
+        return ok;
+    }
+
+    void close() {
+        if (mapped != nullptr) {
+            munmap(mapped, size);
+            mapped = nullptr;
+        }
+        size = 0;
+        image = ImageView();
+    }
+
+    const ImageView& view() const { return image; }
+    const std::string& error() const { return message; }
+
+private:
+    void* mapped;              // Duży plik zmapowany w pamięć
+    std::vector<char> buffer;  // Mały plik wczytany w całości
+    size_t size;
+    ImageView image;
+    std::string message;
+
+    bool fail(const std::string& reason) {
+        close();
+        message = reason;
+        return false;
+    }
+
+    // Siatka '0'/'1': koniec wiersza to "\n" albo "\r\n", puste linie tylko na końcu pliku.
+    // Wszystkie wiersze muszą mieć tę samą długość i te same końce linii (stały odstęp wierszy).
+    bool parseText(const char* text) {
+        size_t width = 0;
+        size_t stride = 0;
+        size_t rows = 0;
+        size_t position = 0;
+        while (position < size) {
+            size_t length = binaryPrefix(text + position, size - position);
+            size_t end = position + length;
+            size_t newline = 0;
+            if (end < size && text[end] == '\n') {
+                newline = 1;
+            } else if (end + 1 < size && text[end] == '\r' && text[end + 1] == '\n') {
+                newline = 2;
+            } else if (end < size) {
+                return fail("niedozwolony znak w wierszu " + std::to_string(rows + 1) + ", kolumnie " + std::to_string(length + 1));
+            }
+            if (length == 0) {
+                // Pusta linia: dalej mogą być już tylko końce linii
+                for (size_t p = end; p < size; ++p) {
+                    if (text[p] != '\n' && text[p] != '\r') {
+                        return fail("pusta linia wewnątrz obrazu (wiersz " + std::to_string(rows + 1) + ")");
+                    }
+                }
+                break;
+            }
+            if (rows == 0) {
+                width = length;
+                stride = length + newline;
+            } else if (length != width) {
+                return fail("wiersz " + std::to_string(rows + 1) + " ma " + std::to_string(length) + " pikseli zamiast "
+                            + std::to_string(width));
+            } else if (newline != 0 && length + newline != stride) {
+                return fail("różne końce linii w wierszach obrazu");
+            }
+            ++rows;
+            position = end + newline;
+        }
+        if (rows == 0) {
+            return fail("brak pikseli");
+        }
+        setView(IMAGE_TEXT, text, size, width, rows, stride);
+        return true;
+    }
+
+    // Liczba dziesiętna z nagłówka PBM, po odstępach i komentarzach
+    bool readPbmNumber(const char* text, size_t& position, size_t& value) {
+        skipPbmSpace(text, position);
+        size_t start = position;
+        value = 0;
+        while (position < size && text[position] >= '0' && text[position] <= '9' && value < (size_t(1) << 32)) {
+            value = value * 10 + (text[position++] - '0');
+        }
+        return position > start && value > 0 && value < (size_t(1) << 32);
+    }
+
+    void skipPbmSpace(const char* text, size_t& position) {
+        while (position < size) {
+            if (text[position] == '#') {
+                while (position < size && text[position] != '\n') {
+                    ++position;
+                }
+            } else if (isPbmSpace(text[position])) {
+                ++position;
+            } else {
+                break;
+            }
+        }
+    }
+
+    bool parsePbm(const char* text, ImageFormat format) {
+        if (size < 3 || !(isPbmSpace(text[2]) || text[2] == '#')) {
+            return fail("błędny nagłówek PBM");
+        }
+        size_t position = 2;
+        size_t width;
+        size_t height;
+        if (!readPbmNumber(text, position, width) || !readPbmNumber(text, position, height)) {
+            return fail("błędny nagłówek PBM");
+        }
+        if (position >= size || !isPbmSpace(text[position])) {
+            return fail("błędny nagłówek PBM");
+        }
+
+        if (format == IMAGE_PBM_RAW) {
+            ++position;  // Dokładnie jeden biały znak przed rastrem
+            size_t row_bytes = (width + 7) / 8;
+            if (size - position != row_bytes * height) {
+                return fail("raster P4 ma " + std::to_string(size - position) + " bajtów zamiast " + std::to_string(row_bytes * height));
+            }
+            setView(IMAGE_PBM_RAW, text + position, size - position, width, height, row_bytes);
+            return true;
+        }
+
+        // P1: ciągi cyfr sprawdzane wektorowo, pomiędzy nimi tylko odstępy
+        size_t start = position;
+        size_t pixels = 0;
+        while (position < size) {
+            size_t digits = binaryPrefix(text + position, size - position);
+            pixels += digits;
+            position += digits;
+            size_t spaces = position;
+            while (position < size && isPbmSpace(text[position])) {
+                ++position;
+            }
+            if (digits == 0 && position == spaces) {
+                return fail("niedozwolony znak w rastrze P1");
+            }
+        }
+        if (pixels != width * height) {
+            return fail("raster P1 ma " + std::to_string(pixels) + " pikseli zamiast " + std::to_string(width * height));
+        }
+        setView(IMAGE_PBM_PLAIN, text + start, size - start, width, height, 0);
+        return true;
+    }
+
+    // Same bity: rozmiar pliku musi odpowiadać wejściu sieci co do bajtu
+    bool parseBits(const char* text, size_t expected_pixels) {
+        if (expected_pixels == 0) {
+            return fail("plik .bits wymaga znanej liczby pikseli");
+        }
+        size_t bytes = (expected_pixels + 7) / 8;
+        if (size != bytes) {
+            return fail("plik .bits ma " + std::to_string(size) + " bajtów zamiast " + std::to_string(bytes));
+        }
+        setView(IMAGE_BITS, text, size, expected_pixels, 1, bytes);
+        return true;
+    }
+
+    void setView(ImageFormat format, const char* data, size_t length, size_t width, size_t height, size_t stride) {
+        image.image_format = format;
+        image.data = data;
+        image.length = length;
+        image.image_width = width;
+        image.image_height = height;
+        image.stride = stride;
+    }
+};
+
+// Odczytuje obraz z pliku i normalizuje wartości pikseli (0 lub 1).
+// Pusty wektor, gdy pliku nie ma albo jest błędny; przyczyna trafia na stderr.
+inline std::vector<double> readImage(const std::string& filename, size_t expected_pixels = 0) {
+    ImageFile file;
+    if (!file.open(filename, expected_pixels)) {
+        std::cerr << "Obraz " << filename << ": " << file.error() << std::endl;
+        return {};
+    }
+    std::vector<double> image(file.view().pixelCount());
+    file.view().decode(image.data());
+    return image;
+}
+
+// Odczytuje obraz z pliku od razu do postaci spakowanej, bez pośredniego wektora double
+inline BitImage readBitImage(const std::string& filename, size_t expected_pixels = 0) {
+    ImageFile file;
+    if (!file.open(filename, expected_pixels)) {
+        std::cerr << "Obraz " << filename << ": " << file.error() << std::endl;
+        return BitImage();
+    }
+    return file.view().toBits();
+}
+
+#endif
@@ -0,0 +1,116 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "image_file.h"
+
+// Sprawdzenie parsera ImageFile: które pliki są przyjmowane (i jakie piksele z nich wychodzą),
+// a które odrzucane. Uruchamiane przez ctest; kod wyjścia 1, gdy którykolwiek przypadek się nie zgadza.
+
+int failures = 0;
+
+std::string temporaryFile(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / ("xoczy_test_" + name)).string();
+}
+
+std::string writeFile(const std::string& name, const std::string& content) {
+    std::string filename = temporaryFile(name);
+    std::ofstream file(filename, std::ios::binary);
+    file.write(content.data(), content.size());
+    return filename;
+}
+
+// Plik ma zostać przyjęty i dać dokładnie piksele pixels ('0'/'1') o podanej szerokości
+void expectImage(ImageFile& file, const std::string& name, const std::string& content, size_t width, const std::string& pixels,
+                 size_t expected_pixels = 0) {
+    std::string filename = writeFile(name, content);
+    if (!file.open(filename, expected_pixels)) {
+        std::cerr << "BŁĄD " << name << ": odrzucony (" << file.error() << ")" << std::endl;
+        ++failures;
+    } else {
+        std::vector<int> decoded(file.view().pixelCount());
+        file.view().decode(decoded.data());
+        std::string text;
+        for (int pixel : decoded) {
+            text += static_cast<char>('0' + pixel);
+        }
+        if (file.view().width() != width || text != pixels) {
+            std::cerr << "BŁĄD " << name << ": szerokość " << file.view().width() << ", piksele " << text << std::endl;
+            ++failures;
+        }
+    }
+    std::filesystem::remove(filename);
+}
+
+// Plik ma zostać odrzucony z komunikatem zawierającym reason
+void expectRejected(ImageFile& file, const std::string& name, const std::string& content, const std::string& reason,
+                    size_t expected_pixels = 0) {
+    std::string filename = writeFile(name, content);
+    if (file.open(filename, expected_pixels)) {
+        std::cerr << "BŁĄD " << name << ": przyjęty, a powinien być odrzucony" << std::endl;
+        ++failures;
+    } else if (file.error().find(reason) == std::string::npos) {
+        std::cerr << "BŁĄD " << name << ": komunikat \"" << file.error() << "\" zamiast \"" << reason << "\"" << std::endl;
+        ++failures;
+    }
+    std::filesystem::remove(filename);
+}
+
+int main() {
+    ImageFile file;  // Jeden obiekt dla wszystkich plików, jak przy wczytywaniu zbioru
+
+    // Tekst: końce linii \n albo \r\n, ostatni wiersz może nie mieć końca linii, puste linie tylko na końcu
+    expectImage(file, "grid.txt", "0110\n1001\n", 4, "01101001");
+    expectImage(file, "crlf.txt", "01\r\n10\r\n", 2, "0110");
+    expectImage(file, "no_newline.txt", "01\n10", 2, "0110");
+    expectImage(file, "trailing.txt", "01\n10\n\n\r\n", 2, "0110");
+    expectRejected(file, "ragged.txt", "011\n10\n", "wiersz 2 ma 2 pikseli zamiast 3");
+    expectRejected(file, "mixed_crlf.txt", "01\r\n10\n11\r\n", "różne końce linii");
+    expectRejected(file, "bad_char.txt", "01\n1x\n", "niedozwolony znak w wierszu 2, kolumnie 2");
+    expectRejected(file, "inner_blank.txt", "01\n\n10\n", "pusta linia wewnątrz obrazu");
+    expectRejected(file, "empty.txt", "", "pusty plik");
+    expectRejected(file, "size.txt", "0110\n1001\n", "obraz ma 8 pikseli zamiast 100", 100);
+
+    // Duży plik (powyżej READ_LIMIT) jest mapowany, a następny mały znów czytany do bufora
+    std::string row(300, '1');
+    std::string big;
+    for (int y = 0; y < 300; ++y) {
+        big += row + "\n";
+    }
+    expectImage(file, "big.txt", big, 300, std::string(300 * 300, '1'));
+    expectImage(file, "after_big.txt", "10\n01\n", 2, "1001");
+
+    // P1: dowolne odstępy i komentarze w nagłówku, cyfry rastra mogą być sklejone
+    expectImage(file, "plain.pbm", "P1\n# komentarz\n3 2\n0 1 0\n1 0 1\n", 3, "010101");
+    expectImage(file, "compact.pbm", "P1 3 2 010101", 3, "010101");
+    expectRejected(file, "p1_count.pbm", "P1\n3 2\n0 1 0\n1 0\n", "raster P1 ma 5 pikseli zamiast 6");
+    expectRejected(file, "p1_char.pbm", "P1\n3 2\n0 1 0\n1 2 1\n", "niedozwolony znak w rastrze P1");
+    expectRejected(file, "p1_width.pbm", "P1\nx 2\n010101\n", "błędny nagłówek PBM");
+    expectRejected(file, "p1_zero.pbm", "P1\n0 2\n", "błędny nagłówek PBM");
+    expectRejected(file, "p1_height.pbm", "P1\n3\n", "błędny nagłówek PBM");
+    expectRejected(file, "p1_magic.pbm", "P1x 3 2 010101", "błędny nagłówek PBM");
+
+    // P4: wiersze dopełnione do pełnego bajtu, bity dopełnienia (tu zapalone) nie są pikselami
+    expectImage(file, "raw.pbm", std::string("P4\n10 2\n") + '\x80' + '\x7f' + '\x00' + '\xff', 10, "10000000010000000011");
+    expectRejected(file, "p4_short.pbm", std::string("P4\n10 2\n") + '\x80' + '\x7f' + '\x00', "raster P4 ma 3 bajtów zamiast 4");
+    expectRejected(file, "p4_header.pbm", "P4\n10 2", "błędny nagłówek PBM");
+
+    // .bits: rozmiar tylko z wejścia sieci, długość pliku co do bajtu
+    expectImage(file, "image.bits", std::string() + '\xa0' + '\x40', 10, "1010000001", 10);
+    expectRejected(file, "long.bits", std::string() + '\xa0' + '\x40' + '\x00', "plik .bits ma 3 bajtów zamiast 2", 10);
+    expectRejected(file, "unsized.bits", std::string() + '\xa0' + '\x40', "wymaga znanej liczby pikseli");
+
+    if (file.open(temporaryFile("does_not_exist.txt"))) {
+        std::cerr << "BŁĄD brak pliku: przyjęty" << std::endl;
+        ++failures;
+    }
+
+    if (failures > 0) {
+        std::cerr << failures << " przypadków niezgodnych." << std::endl;
+        return 1;
+    }
+    std::cout << "ImageFile: wszystkie przypadki zgodne." << std::endl;
+    return 0;
+}
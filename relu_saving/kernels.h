@@ -0,0 +1,362 @@
+#ifndef XOCZY_KERNELS_H
+#define XOCZY_KERNELS_H
+
+#include <algorithm>
+#include <cstring>
+#include <immintrin.h>
+
+// Podstawowe operacje wektorowe w trzech wersjach: skalarnej, AVX2 i AVX-512,
+// dla liczb double i float. Wersja wybierana jest raz, przy pierwszym użyciu,
+// na podstawie CPUID procesora, więc ten sam plik wykonywalny działa na każdej maszynie.
+
+// Iloczyn skalarny a[0..n) * b[0..n)
+template <typename T>
+T dotScalar(const T* a, const T* b, int n) {
+    T sum = 0;
+    for (int i = 0; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+// y[0..n) += alpha * x[0..n)  (aktualizacja wag rzędu 1)
+template <typename T>
+void axpyScalar(T alpha, const T* x, T* y, int n) {
+    for (int i = 0; i < n; ++i) {
+        y[i] += alpha * x[i];
+    }
+}
+
+// x[0..n) = max(x, 0)
+template <typename T>
+void reluScalar(T* x, int n) {
+    for (int i = 0; i < n; ++i) {
+        x[i] = x[i] > 0 ? x[i] : 0;
+    }
+}
+
+__attribute__((target("avx2,fma")))
+inline double dotAvx2(const double* a, const double* b, int n) {
+    __m256d sum0 = _mm256_setzero_pd();
+    __m256d sum1 = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        sum0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), sum0);
+        sum1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), sum1);
+    }
+    for (; i + 4 <= n; i += 4) {
+        sum0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), sum0);
+    }
+    sum0 = _mm256_add_pd(sum0, sum1);
+    __m128d half = _mm_add_pd(_mm256_castpd256_pd128(sum0), _mm256_extractf128_pd(sum0, 1));
+    double sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+inline float dotAvx2(const float* a, const float* b, int n) {
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+        sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), sum1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+    }
+    sum0 = _mm256_add_ps(sum0, sum1);
+    __m128 quarter = _mm_add_ps(_mm256_castps256_ps128(sum0), _mm256_extractf128_ps(sum0, 1));
+    quarter = _mm_add_ps(quarter, _mm_movehl_ps(quarter, quarter));
+    float sum = _mm_cvtss_f32(_mm_add_ss(quarter, _mm_movehdup_ps(quarter)));
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+inline void axpyAvx2(double alpha, const double* x, double* y, int n) {
+    __m256d a = _mm256_set1_pd(alpha);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(y + i, _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    }
+    for (; i < n; ++i) {
+        y[i] += alpha * x[i];
+    }
+}
+
+__attribute__((target("avx2,fma")))
+inline void axpyAvx2(float alpha, const float* x, float* y, int n) {
+    __m256 a = _mm256_set1_ps(alpha);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(a, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    }
+    for (; i < n; ++i) {
+        y[i] += alpha * x[i];
+    }
+}
+
+__attribute__((target("avx2")))
+inline void reluAvx2(double* x, int n) {
+    __m256d zero = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(x + i, _mm256_max_pd(_mm256_loadu_pd(x + i), zero));
+    }
+    for (; i < n; ++i) {
+        x[i] = x[i] > 0 ? x[i] : 0;
+    }
+}
+
+__attribute__((target("avx2")))
+inline void reluAvx2(float* x, int n) {
+    __m256 zero = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(x + i, _mm256_max_ps(_mm256_loadu_ps(x + i), zero));
+    }
+    for (; i < n; ++i) {
+        x[i] = x[i] > 0 ? x[i] : 0;
+    }
+}
+
+__attribute__((target("avx512f")))
+inline double dotAvx512(const double* a, const double* b, int n) {
+    __m512d sum0 = _mm512_setzero_pd();
+    __m512d sum1 = _mm512_setzero_pd();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        sum0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), sum0);
+        sum1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8), sum1);
+    }
+    if (i + 8 <= n) {
+        sum0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), sum0);
+        i += 8;
+    }
+    if (i < n) {
+        __mmask8 tail = static_cast<__mmask8>((1u << (n - i)) - 1);  // Reszta (< 8 elementów) jedną maskowaną operacją
+        sum1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(tail, a + i), _mm512_maskz_loadu_pd(tail, b + i), sum1);
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(sum0, sum1));
+}
+
+__attribute__((target("avx512f")))
+inline float dotAvx512(const float* a, const float* b, int n) {
+    __m512 sum0 = _mm512_setzero_ps();
+    __m512 sum1 = _mm512_setzero_ps();
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        sum0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), sum0);
+        sum1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), sum1);
+    }
+    if (i + 16 <= n) {
+        sum0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), sum0);
+        i += 16;
+    }
+    if (i < n) {
+        __mmask16 tail = static_cast<__mmask16>((1u << (n - i)) - 1);  // Reszta (< 16 elementów) jedną maskowaną operacją
+        sum1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, a + i), _mm512_maskz_loadu_ps(tail, b + i), sum1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(sum0, sum1));
+}
+
+__attribute__((target("avx512f")))
+inline void axpyAvx512(double alpha, const double* x, double* y, int n) {
+    __m512d a = _mm512_set1_pd(alpha);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm512_storeu_pd(y + i, _mm512_fmadd_pd(a, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+    }
+    if (i < n) {
+        __mmask8 tail = static_cast<__mmask8>((1u << (n - i)) - 1);
+        __m512d result = _mm512_fmadd_pd(a, _mm512_maskz_loadu_pd(tail, x + i), _mm512_maskz_loadu_pd(tail, y + i));
+        _mm512_mask_storeu_pd(y + i, tail, result);
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void axpyAvx512(float alpha, const float* x, float* y, int n) {
+    __m512 a = _mm512_set1_ps(alpha);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(y + i, _mm512_fmadd_ps(a, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+    }
+    if (i < n) {
+        __mmask16 tail = static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512 result = _mm512_fmadd_ps(a, _mm512_maskz_loadu_ps(tail, x + i), _mm512_maskz_loadu_ps(tail, y + i));
+        _mm512_mask_storeu_ps(y + i, tail, result);
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void reluAvx512(double* x, int n) {
+    __m512d zero = _mm512_setzero_pd();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm512_storeu_pd(x + i, _mm512_max_pd(_mm512_loadu_pd(x + i), zero));
+    }
+    if (i < n) {
+        __mmask8 tail = static_cast<__mmask8>((1u << (n - i)) - 1);
+        _mm512_mask_storeu_pd(x + i, tail, _mm512_max_pd(_mm512_maskz_loadu_pd(tail, x + i), zero));
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void reluAvx512(float* x, int n) {
+    __m512 zero = _mm512_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(x + i, _mm512_max_ps(_mm512_loadu_ps(x + i), zero));
+    }
+    if (i < n) {
+        __mmask16 tail = static_cast<__mmask16>((1u << (n - i)) - 1);
+        _mm512_mask_storeu_ps(x + i, tail, _mm512_max_ps(_mm512_maskz_loadu_ps(tail, x + i), zero));
+    }
+}
+
+// Zestaw funkcji wybrany dla bieżącego procesora
+template <typename T>
+struct KernelTable {
+    const char* name;
+    T (*dot)(const T*, const T*, int);
+    void (*axpy)(T, const T*, T*, int);
+    void (*relu)(T*, int);
+};
+
+// Zestawy dla danego typu liczb: skalarny, AVX2, AVX-512
+template <typename T>
+struct KernelSets {
+    static constexpr KernelTable<T> scalar = {"scalar", dotScalar<T>, axpyScalar<T>, reluScalar<T>};
+    static constexpr KernelTable<T> avx2 = {"avx2", dotAvx2, axpyAvx2, reluAvx2};
+    static constexpr KernelTable<T> avx512 = {"avx512", dotAvx512, axpyAvx512, reluAvx512};
+};
+
+// Nazwa najlepszego zestawu obsługiwanego przez procesor
+inline const char* detectKernels() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return "avx512";
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return "avx2";
+    }
+    return "scalar";
+}
+
+template <typename T>
+const KernelTable<T>* kernelsByName(const char* name) {
+    if (std::strcmp(name, "avx512") == 0) {
+        return &KernelSets<T>::avx512;
+    }
+    if (std::strcmp(name, "avx2") == 0) {
+        return &KernelSets<T>::avx2;
+    }
+    return &KernelSets<T>::scalar;
+}
+
+template <typename T>
+const KernelTable<T>*& activeKernels() {
+    static const KernelTable<T>* table = kernelsByName<T>(detectKernels());
+    return table;
+}
+
+// Zestaw funkcji używany przez sieć dla typu T
+template <typename T = double>
+const KernelTable<T>& kernels() {
+    return *activeKernels<T>();
+}
+
+// Wymusza konkretny zestaw ("scalar", "avx2", "avx512") dla wszystkich typów, np. do porównań wydajności.
+// Zwraca false, gdy procesor go nie obsługuje albo nazwa jest nieznana.
+inline bool selectKernels(const char* name) {
+    __builtin_cpu_init();
+    bool supported = std::strcmp(name, "scalar") == 0
+        || (std::strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        || (std::strcmp(name, "avx512") == 0 && __builtin_cpu_supports("avx512f"));
+    if (!supported) {
+        return false;
+    }
+    activeKernels<double>() = kernelsByName<double>(name);
+    activeKernels<float>() = kernelsByName<float>(name);
+    return true;
+}
+
+// Blokowane mnożenia macierzy używane przez uczenie paczkami (trainBatch).
+// Wszystkie macierze są gęste, zapisane wierszami (row-major).
+// Bloki dobrane tak, żeby kafelki A i B mieściły się razem w L1/L2.
+const int BLOCK_ROWS = 32;   // Wiersze wyniku w jednym bloku
+const int BLOCK_COLS = 32;   // Kolumny wyniku w jednym bloku
+const int BLOCK_DEPTH = 256; // Długość fragmentu iloczynu skalarnego
+
+// C[M x N] = A[M x K] * B[N x K]^T
+// Obie macierze czytane są wzdłuż wierszy, co pasuje do układu wag [neuron][wejście].
+template <typename T>
+void gemmNT(const T* A, const T* B, T* C, int M, int N, int K) {
+    const KernelTable<T>& kt = kernels<T>();
+    std::fill(C, C + M * N, T(0));
+    for (int k0 = 0; k0 < K; k0 += BLOCK_DEPTH) {
+        int k1 = std::min(k0 + BLOCK_DEPTH, K);
+        for (int i0 = 0; i0 < M; i0 += BLOCK_ROWS) {
+            int i1 = std::min(i0 + BLOCK_ROWS, M);
+            for (int j0 = 0; j0 < N; j0 += BLOCK_COLS) {
+                int j1 = std::min(j0 + BLOCK_COLS, N);
+                for (int i = i0; i < i1; ++i) {
+                    const T* a = A + i * K;
+                    for (int j = j0; j < j1; ++j) {
+                        C[i * N + j] += kt.dot(a + k0, B + j * K + k0, k1 - k0);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// C[M x N] = A[M x K] * B[K x N]
+template <typename T>
+void gemmNN(const T* A, const T* B, T* C, int M, int N, int K) {
+    const KernelTable<T>& kt = kernels<T>();
+    std::fill(C, C + M * N, T(0));
+    for (int i0 = 0; i0 < M; i0 += BLOCK_ROWS) {
+        int i1 = std::min(i0 + BLOCK_ROWS, M);
+        for (int k0 = 0; k0 < K; k0 += BLOCK_DEPTH) {
+            int k1 = std::min(k0 + BLOCK_DEPTH, K);
+            for (int i = i0; i < i1; ++i) {
+                T* c = C + i * N;
+                for (int k = k0; k < k1; ++k) {
+                    kt.axpy(A[i * K + k], B + k * N, c, N);  // Wiersz B dodawany do wiersza C (dostęp sekwencyjny)
+                }
+            }
+        }
+    }
+}
+
+// C[M x N] += alpha * A[K x M]^T * B[K x N]
+// Akumulacja gradientu wag: suma po próbkach paczki (K) iloczynów zewnętrznych błędu i wejścia.
+template <typename T>
+void gemmTN(const T* A, const T* B, T* C, int M, int N, int K, T alpha) {
+    const KernelTable<T>& kt = kernels<T>();
+    for (int i0 = 0; i0 < M; i0 += BLOCK_ROWS) {
+        int i1 = std::min(i0 + BLOCK_ROWS, M);
+        for (int j0 = 0; j0 < N; j0 += BLOCK_DEPTH) {
+            int j1 = std::min(j0 + BLOCK_DEPTH, N);
+            for (int k = 0; k < K; ++k) {
+                const T* b = B + k * N;
+                for (int i = i0; i < i1; ++i) {
+                    T a = alpha * A[k * M + i];
+                    if (a == 0) {
+                        continue;  // Martwy neuron ReLU nie zmienia wag
+                    }
+                    kt.axpy(a, b + j0, C + i * N + j0, j1 - j0);
+                }
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,219 @@
+#ifndef XOCZY_LOADER_H
+#define XOCZY_LOADER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dataset.h"
+#include "random.h"
+#include "telemetry.h"
+
+// Uczenie na zmienionych wersjach obrazów (augmentacja) bez czekania na ich przygotowanie.
+//
+// Zbiór bazowy jest już w pamięci (wczytany raz przed uczeniem). Wątki ładujące w tle
+// tworzą z niego kolejne porcje próbek z losowym przesunięciem, odbiciem, obrotem o 90°
+// i szumem pikseli, do pierścienia kilku gotowych porcji. Wątek uczący bierze porcje po kolei,
+// a w tym czasie następne są już przygotowywane.
+// Porcja nr g zależy tylko od ziarna i g, więc wynik uczenia nie zależy od liczby wątków ładujących.
+
+struct AugmentSettings {
+    bool shift = false;   // Przesunięcie o najwyżej max_shift pikseli w każdej osi (puste pola = 0)
+    bool flip = false;    // Odbicie lustrzane w poziomie z prawdopodobieństwem 1/2
+    bool rotate = false;  // Obrót o 0, 90, 180 albo 270 stopni
+    int max_shift = 2;
+    double noise = 0;     // Prawdopodobieństwo odwrócenia każdego piksela
+
+    bool enabled() const { return shift || flip || rotate || noise > 0; }
+};
+
+// Lista przekształceń oddzielonych przecinkami, np. "shift,flip,rotate,noise".
+// Samo "noise" bez --noise oznacza odwrócenie 2% pikseli.
+inline bool parseAugment(const std::string& list, AugmentSettings& settings) {
+    std::istringstream items(list);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        if (item == "shift") {
+            settings.shift = true;
+        } else if (item == "flip") {
+            settings.flip = true;
+        } else if (item == "rotate") {
+            settings.rotate = true;
+        } else if (item == "noise") {
+            settings.noise = settings.noise > 0 ? settings.noise : 0.02;
+        } else {
+            std::cerr << "Nieznane przekształcenie: " << item << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Zmieniona kopia kwadratowego obrazu side x side. Dla każdego piksela wyniku liczone jest,
+// skąd pochodzi w obrazie źródłowym (przekształcenia odwrotne w odwrotnej kolejności),
+// więc nie potrzeba bufora pośredniego.
+template <typename T>
+void augmentImage(const T* source, T* target, int side, const AugmentSettings& settings, Xoshiro256& random) {
+    int turns = settings.rotate ? static_cast<int>(random.next() & 3) : 0;
+    bool mirror = settings.flip && (random.next() & 1);
+    int span = 2 * settings.max_shift + 1;
+    int dx = settings.shift ? static_cast<int>(random.next() % span) - settings.max_shift : 0;
+    int dy = settings.shift ? static_cast<int>(random.next() % span) - settings.max_shift : 0;
+
+    for (int y = 0; y < side; ++y) {
+        for (int x = 0; x < side; ++x) {
+            int r = y - dy;
+            int c = x - dx;
+            T value = 0;
+            if (r >= 0 && r < side && c >= 0 && c < side) {
+                if (mirror) {
+                    c = side - 1 - c;
+                }
+                // Obrót o 90° w prawo przenosi (r, c) na (c, side-1-r); tu cofamy go turns razy
+                for (int t = 0; t < turns; ++t) {
+                    int previous_r = side - 1 - c;
+                    c = r;
+                    r = previous_r;
+                }
+                value = source[r * side + c];
+            }
+            if (settings.noise > 0 && random.uniform() < settings.noise) {
+                value = 1 - value;  // Obrazy są binarne: szum odwraca piksel
+            }
+            target[y * side + x] = value;
+        }
+    }
+}
+
+// Pierścień porcji zmienionych próbek przygotowywanych w tle.
+// Epoka to chunksPerEpoch() porcji; porcja c epoki zawiera próbki bazowe [c * chunk, (c + 1) * chunk),
+// każdą z własnym losowym przekształceniem. next() zwraca porcje po kolei, release() oddaje
+// bieżącą porcję wątkom ładującym.
+template <typename T>
+class AugmentedLoader {
+public:
+    AugmentedLoader(const BasicDataset<T>& base, const AugmentSettings& settings, size_t chunk_size, int workers, int prefetch,
+                    uint64_t seed)
+        : base(base), settings(settings), side(static_cast<int>(std::lround(std::sqrt(base.inputSize())))),
+          chunk_size(std::max<size_t>(1, chunk_size)), seed(seed), slots(std::max(2, prefetch)) {
+        for (int w = 0; w < std::max(1, workers); ++w) {
+            threads.emplace_back([this] { work(); });
+        }
+    }
+
+    ~AugmentedLoader() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        slot_free.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    // Tylko obrazy kwadratowe mogą być obracane i przesuwane
+    static bool validInput(const BasicDataset<T>& data) {
+        size_t side = static_cast<size_t>(std::lround(std::sqrt(data.inputSize())));
+        return side * side == data.inputSize();
+    }
+
+    size_t chunksPerEpoch() const { return (base.size() + chunk_size - 1) / chunk_size; }
+
+    // Następna porcja; czeka tylko wtedy, gdy wątki ładujące nie zdążyły jej przygotować
+    const BasicDataset<T>& next() {
+        Slot& slot = slots[consumed % slots.size()];
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!(slot.ready && slot.chunk == consumed)) {
+            TELEMETRY_SCOPE("wait_data");
+            auto start = std::chrono::steady_clock::now();
+            slot_ready.wait(lock, [&] { return slot.ready && slot.chunk == consumed; });
+            std::chrono::duration<double> waited = std::chrono::steady_clock::now() - start;
+            wait_seconds += waited.count();
+            ++stalls;
+        }
+        return slot.data;
+    }
+
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            slots[consumed % slots.size()].ready = false;
+            ++consumed;
+        }
+        slot_free.notify_all();
+    }
+
+    // Łączny czas oczekiwania wątku uczącego na dane i liczba takich przestojów
+    double waitSeconds() const { return wait_seconds; }
+    uint64_t stallCount() const { return stalls; }
+
+private:
+    struct Slot {
+        BasicDataset<T> data;
+        uint64_t chunk = 0;
+        bool ready = false;
+    };
+
+    const BasicDataset<T>& base;
+    AugmentSettings settings;
+    int side;
+    size_t chunk_size;
+    uint64_t seed;
+    std::vector<Slot> slots;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable slot_ready;
+    std::condition_variable slot_free;
+    uint64_t next_chunk = 0;  // Następna porcja do przygotowania
+    uint64_t consumed = 0;    // Porcje oddane przez wątek uczący
+    bool stopping = false;
+    double wait_seconds = 0;
+    uint64_t stalls = 0;
+
+    void work() {
+        while (true) {
+            uint64_t chunk;
+            {
+                // Porcja g trafia do miejsca g % slots; jest wolne, gdy porcja g - slots została oddana
+                std::unique_lock<std::mutex> lock(mutex);
+                slot_free.wait(lock, [&] { return stopping || next_chunk < consumed + slots.size(); });
+                if (stopping) {
+                    return;
+                }
+                chunk = next_chunk++;
+            }
+            Slot& slot = slots[chunk % slots.size()];
+            fill(chunk, slot.data);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                slot.chunk = chunk;
+                slot.ready = true;
+            }
+            slot_ready.notify_all();
+        }
+    }
+
+    void fill(uint64_t chunk, BasicDataset<T>& data) {
+        TELEMETRY_SCOPE("augment");
+        size_t first = (chunk % chunksPerEpoch()) * chunk_size;
+        size_t count = std::min(chunk_size, base.size() - first);
+        size_t label_size = base.labelSize();
+        data.reshape(count, base.inputSize(), label_size);
+        Xoshiro256 random(seed, (uint64_t(1) << 32) + chunk);  // Strumienie poza tymi używanymi przy inicjalizacji
+        for (size_t i = 0; i < count; ++i) {
+            augmentImage(base.sample(first + i), data.sample(i), side, settings, random);
+            std::copy(base.label(first + i), base.label(first + i) + label_size, data.label(i));
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,303 @@
+#ifndef XOCZY_MODEL_FILE_H
+#define XOCZY_MODEL_FILE_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "kernels.h"
+#include "simple_nn.h"
+
+// Binarny format modelu (zamiast weights.txt z jedną liczbą w linii):
+//
+//   [nagłówek 64 B][wagi wejście->ukryta][wagi ukryta->wyjście]
+//
+// Każdy blok wag zaczyna się na granicy 64 bajtów, więc po zmapowaniu pliku (mmap)
+// wagi można od razu czytać instrukcjami SIMD, bez parsowania i bez kopiowania.
+// Liczby zapisane są w kolejności bajtów procesora (little-endian na x86).
+
+const char MODEL_MAGIC[4] = {'X', 'O', 'C', 'Z'};
+const uint32_t MODEL_VERSION = 1;
+const uint64_t MODEL_ALIGNMENT = 64;
+
+// Typ liczb w blokach wag
+enum ModelDType : uint32_t {
+    DTYPE_FLOAT64 = 0,
+    DTYPE_FLOAT32 = 1,
+};
+
+// Funkcja aktywacji warstwy
+enum ModelActivation : uint32_t {
+    ACTIVATION_RELU = 0,
+    ACTIVATION_SIGMOID = 1,
+    ACTIVATION_SOFTMAX = 2,  // Tylko warstwa wyjściowa klasyfikatora
+};
+
+struct ModelHeader {
+    char magic[4];                  // "XOCZ"
+    uint32_t version;               // MODEL_VERSION
+    uint32_t input_size;            // Liczba wejść
+    uint32_t hidden_size;           // Liczba neuronów ukrytych
+    uint32_t output_size;           // Liczba wyjść
+    uint32_t dtype;                 // ModelDType
+    uint32_t hidden_activation;     // ModelActivation warstwy ukrytej
+    uint32_t output_activation;     // ModelActivation warstwy wyjściowej
+    uint64_t input_hidden_offset;   // Początek wag wejście->ukryta (bajty od początku pliku)
+    uint64_t hidden_output_offset;  // Początek wag ukryta->wyjście
+    uint64_t file_size;             // Rozmiar całego pliku
+    uint64_t checksum;              // FNV-1a 64 wszystkich bajtów za nagłówkiem
+};
+static_assert(sizeof(ModelHeader) == 64, "Nagłówek modelu musi mieć 64 bajty");
+
+// Suma kontrolna FNV-1a 64
+inline uint64_t modelChecksum(const unsigned char* data, size_t size) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+inline uint64_t alignModelOffset(uint64_t offset) {
+    return (offset + MODEL_ALIGNMENT - 1) / MODEL_ALIGNMENT * MODEL_ALIGNMENT;
+}
+
+template <typename T>
+uint32_t modelDType() {
+    return sizeof(T) == sizeof(double) ? DTYPE_FLOAT64 : DTYPE_FLOAT32;
+}
+
+// Zapisuje sieć w formacie binarnym; typ liczb w pliku taki jak typ sieci
+template <typename T>
+bool saveModel(const BasicNN<T>& nn, const std::string& filename) {
+    TELEMETRY_SCOPE("save_model");
+    const std::vector<T>& w1 = nn.inputHiddenWeights();
+    const std::vector<T>& w2 = nn.hiddenOutputWeights();
+
+    ModelHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MODEL_MAGIC, sizeof(MODEL_MAGIC));
+    header.version = MODEL_VERSION;
+    header.input_size = nn.inputSize();
+    header.hidden_size = nn.hiddenSize();
+    header.output_size = nn.outputSize();
+    header.dtype = modelDType<T>();
+    header.hidden_activation = ACTIVATION_RELU;
+    header.output_activation = nn.outputActivation() == OUTPUT_SOFTMAX ? ACTIVATION_SOFTMAX : ACTIVATION_SIGMOID;
+    header.input_hidden_offset = alignModelOffset(sizeof(ModelHeader));
+    header.hidden_output_offset = alignModelOffset(header.input_hidden_offset + w1.size() * sizeof(T));
+    header.file_size = alignModelOffset(header.hidden_output_offset + w2.size() * sizeof(T));
+
+    // Cały plik budowany w pamięci, żeby policzyć sumę kontrolną przed zapisem
+    std::vector<unsigned char> body(header.file_size - sizeof(ModelHeader), 0);
+    std::memcpy(&body[header.input_hidden_offset - sizeof(ModelHeader)], w1.data(), w1.size() * sizeof(T));
+    std::memcpy(&body[header.hidden_output_offset - sizeof(ModelHeader)], w2.data(), w2.size() * sizeof(T));
+    header.checksum = modelChecksum(body.data(), body.size());
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Nie można zapisać modelu " << filename << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(body.data()), body.size());
+    return file.good();
+}
+
+// Model zmapowany z pliku tylko do odczytu.
+// forward() liczy wynik bezpośrednio na zmapowanych stronach pliku - wagi nie są kopiowane.
+class MappedModel {
+public:
+    MappedModel() : data(nullptr), size(0), header(nullptr) {}
+    ~MappedModel() { close(); }
+
+    MappedModel(const MappedModel&) = delete;
+    MappedModel& operator=(const MappedModel&) = delete;
+
+    // Mapuje plik i sprawdza nagłówek, rozmiary bloków i (opcjonalnie) sumę kontrolną
+    bool open(const std::string& filename, bool verify_checksum = true) {
+        close();
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(ModelHeader))) {
+            ::close(fd);
+            std::cerr << "Plik " << filename << " nie jest modelem." << std::endl;
+            return false;
+        }
+        size = info.st_size;
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);  // Mapowanie pozostaje ważne po zamknięciu deskryptora
+        if (mapped == MAP_FAILED) {
+            std::cerr << "Nie można zmapować " << filename << std::endl;
+            size = 0;
+            return false;
+        }
+        data = static_cast<const unsigned char*>(mapped);
+        header = reinterpret_cast<const ModelHeader*>(data);
+
+        std::string error = validate(verify_checksum);
+        if (!error.empty()) {
+            std::cerr << "Błędny model " << filename << ": " << error << std::endl;
+            close();
+            return false;
+        }
+
+        hidden.resize(header->hidden_size);
+        output.resize(header->output_size);
+        input_float.resize(header->input_size);
+        hidden_float.resize(header->hidden_size);
+        output_float.resize(header->output_size);
+        return true;
+    }
+
+    void close() {
+        if (data != nullptr) {
+            munmap(const_cast<unsigned char*>(data), size);
+        }
+        data = nullptr;
+        header = nullptr;
+        size = 0;
+    }
+
+    bool isOpen() const { return data != nullptr; }
+    const ModelHeader& info() const { return *header; }
+
+    const std::vector<double>& forward(const std::vector<double>& inputs) {
+        return forward(inputs.data());
+    }
+
+    // Forward propagation na wagach z pliku
+    const std::vector<double>& forward(const double* inputs) {
+        if (header->dtype == DTYPE_FLOAT64) {
+            forwardLayers(inputs, hidden.data(), output.data());
+        } else {
+            // Wagi float: wejście konwertowane raz, sumy liczone w float
+            for (uint32_t j = 0; j < header->input_size; ++j) {
+                input_float[j] = static_cast<float>(inputs[j]);
+            }
+            forwardLayers(input_float.data(), hidden_float.data(), output_float.data());
+            output.assign(output_float.begin(), output_float.end());
+        }
+        return output;
+    }
+
+    // Wskaźniki na bloki wag w zmapowanym pliku
+    template <typename T>
+    const T* inputHiddenWeights() const { return reinterpret_cast<const T*>(data + header->input_hidden_offset); }
+    template <typename T>
+    const T* hiddenOutputWeights() const { return reinterpret_cast<const T*>(data + header->hidden_output_offset); }
+
+private:
+    const unsigned char* data;  // Początek zmapowanego pliku
+    size_t size;
+    const ModelHeader* header;
+    std::vector<double> hidden;
+    std::vector<double> output;
+    std::vector<float> input_float;
+    std::vector<float> hidden_float;
+    std::vector<float> output_float;
+
+    std::string validate(bool verify_checksum) const {
+        if (std::memcmp(header->magic, MODEL_MAGIC, sizeof(MODEL_MAGIC)) != 0) {
+            return "zła sygnatura";
+        }
+        if (header->version != MODEL_VERSION) {
+            return "nieobsługiwana wersja " + std::to_string(header->version);
+        }
+        if (header->dtype != DTYPE_FLOAT64 && header->dtype != DTYPE_FLOAT32) {
+            return "nieznany typ liczb";
+        }
+        if (header->hidden_activation != ACTIVATION_RELU
+            || (header->output_activation != ACTIVATION_SIGMOID && header->output_activation != ACTIVATION_SOFTMAX)) {
+            return "nieobsługiwane funkcje aktywacji";
+        }
+        // Najpierw przesunięcia względem rozmiaru pliku, potem liczby wag względem miejsca w bloku.
+        // Iloczyn dwóch pól 32-bitowych mieści się w 64 bitach, a dzielenie zamiast mnożenia przez
+        // rozmiar liczby nie daje przepełnienia, więc spreparowany nagłówek nie przejdzie sprawdzenia.
+        uint64_t element = header->dtype == DTYPE_FLOAT64 ? sizeof(double) : sizeof(float);
+        uint64_t w1_count = uint64_t(header->input_size) * header->hidden_size;
+        uint64_t w2_count = uint64_t(header->hidden_size) * header->output_size;
+        if (header->file_size != size
+            || header->input_hidden_offset % MODEL_ALIGNMENT != 0 || header->hidden_output_offset % MODEL_ALIGNMENT != 0
+            || header->input_hidden_offset < sizeof(ModelHeader)
+            || header->input_hidden_offset > header->hidden_output_offset || header->hidden_output_offset > size
+            || w1_count > (header->hidden_output_offset - header->input_hidden_offset) / element
+            || w2_count > (size - header->hidden_output_offset) / element) {
+            return "rozmiary bloków nie zgadzają się z plikiem";
+        }
+        if (verify_checksum && modelChecksum(data + sizeof(ModelHeader), size - sizeof(ModelHeader)) != header->checksum) {
+            return "zła suma kontrolna";
+        }
+        return "";
+    }
+
+    template <typename T>
+    void forwardLayers(const T* inputs, T* hidden_layer, T* output_layer) const {
+        const KernelTable<T>& kt = kernels<T>();
+        int input_size = header->input_size;
+        int hidden_size = header->hidden_size;
+        const T* w1 = inputHiddenWeights<T>();
+        const T* w2 = hiddenOutputWeights<T>();
+
+        for (int i = 0; i < hidden_size; ++i) {
+            hidden_layer[i] = kt.dot(inputs, w1 + i * input_size, input_size);  // Suma ważona
+        }
+        kt.relu(hidden_layer, hidden_size);  // Aktywacja ReLU
+        for (uint32_t i = 0; i < header->output_size; ++i) {
+            output_layer[i] = kt.dot(hidden_layer, w2 + i * hidden_size, hidden_size);
+        }
+        if (header->output_activation == ACTIVATION_SOFTMAX) {
+            softmaxRows(output_layer, 1, header->output_size);
+        } else {
+            for (uint32_t i = 0; i < header->output_size; ++i) {
+                output_layer[i] = T(1) / (T(1) + std::exp(-output_layer[i]));  // Aktywacja sigmoid
+            }
+        }
+    }
+};
+
+// Wczytuje model binarny do zwykłej sieci (kopia wag), np. dla ścieżek, które potrzebują BasicNN
+template <typename T>
+bool loadModel(BasicNN<T>& nn, const std::string& filename) {
+    MappedModel model;
+    if (!model.open(filename)) {
+        return false;
+    }
+    const ModelHeader& header = model.info();
+    if (header.input_size != nn.inputSize() || header.hidden_size != nn.hiddenSize() || header.output_size != nn.outputSize()) {
+        std::cerr << "Rozmiary modelu " << filename << " nie pasują do sieci." << std::endl;
+        return false;
+    }
+    nn.setOutputActivation(header.output_activation == ACTIVATION_SOFTMAX ? OUTPUT_SOFTMAX : OUTPUT_SIGMOID);
+    if (header.dtype == DTYPE_FLOAT64) {
+        nn.setWeights(model.inputHiddenWeights<double>(), model.hiddenOutputWeights<double>());
+    } else {
+        nn.setWeights(model.inputHiddenWeights<float>(), model.hiddenOutputWeights<float>());
+    }
+    return true;
+}
+
+// Jednorazowa konwersja weights.txt do formatu binarnego
+inline bool convertWeights(const std::string& text_file, const std::string& model_file, int input_size, int hidden_size, int output_size,
+                           OutputActivation output_activation = OUTPUT_SIGMOID) {
+    SimpleNN nn(input_size, hidden_size, output_size);
+    nn.setOutputActivation(output_activation);
+    if (!nn.loadWeights(text_file)) {
+        return false;
+    }
+    return saveModel(nn, model_file);
+}
+
+#endif
@@ -0,0 +1,399 @@
+#ifndef XOCZY_NETWORK_H
+#define XOCZY_NETWORK_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "dataset.h"
+#include "kernels.h"
+#include "optimizer.h"
+#include "random.h"
+#include "softmax.h"
+#include "telemetry.h"
+
+// Sieć złożona z dowolnej liczby warstw: Dense (wagi [wyjście][wejście], bez biasu, jak w SimpleNN)
+// i funkcji aktywacji (ReLU, sigmoid) działających w miejscu na wyniku poprzedniej warstwy Dense.
+// Warianty programu to tylko różne konfiguracje (simple/ i relu/ wołają runVariant z variant.h):
+//   simple      = 100 -> Dense 15 -> sigmoid -> Dense 1 -> sigmoid
+//   relu        = 100 -> Dense 30 -> ReLU    -> Dense 1 -> sigmoid
+//   głębsze     = np. 100 -> Dense 64 -> ReLU -> Dense 32 -> ReLU -> Dense 1 -> sigmoid
+// Model binarny, wykrywanie wsadowe, serwer, int8 i przycinanie korzystają z jednowarstwowej
+// BasicNN (ReLU w warstwie ukrytej); LayerStack obsługuje uczenie i wykrywanie detection.txt z --layers.
+//
+// Wszystkie wagi leżą w jednym ciągłym buforze (arena parametrów), każda warstwa od granicy 64 bajtów.
+// Wyniki warstw dla jednej próbki również leżą w jednym buforze, jeden za drugim,
+// więc forward przechodzi pamięć po kolei: wiersz wag, wejście warstwy, wynik warstwy.
+
+enum LayerType {
+    LAYER_DENSE,
+    LAYER_RELU,
+    LAYER_SIGMOID,
+    LAYER_SOFTMAX,  // Tylko jako ostatnia warstwa: klasyfikator wieloklasowy
+};
+
+// Opis warstwy przy budowaniu sieci; size ma znaczenie tylko dla Dense (liczba neuronów)
+struct LayerSpec {
+    LayerType type;
+    int size;
+};
+
+// Odczytuje opis "100-64-32-1" (wejście, warstwy ukryte, wyjście).
+// Po każdej warstwie ukrytej wstawiana jest aktywacja hidden_activation ("relu" albo "sigmoid"),
+// po wyjściowej - sigmoid, a dla klasyfikatora (softmax_output) - softmax.
+inline bool parseTopology(const std::string& text, const std::string& hidden_activation, int& input_size, std::vector<LayerSpec>& layers,
+                          bool softmax_output = false) {
+    std::vector<int> sizes;
+    std::istringstream fields(text);
+    std::string field;
+    while (std::getline(fields, field, '-')) {
+        int size = std::atoi(field.c_str());
+        if (size <= 0) {
+            std::cerr << "Błędny rozmiar warstwy w " << text << std::endl;
+            return false;
+        }
+        sizes.push_back(size);
+    }
+    if (sizes.size() < 2) {
+        std::cerr << "Sieć potrzebuje co najmniej wejścia i wyjścia: " << text << std::endl;
+        return false;
+    }
+    LayerType activation;
+    if (hidden_activation == "relu") {
+        activation = LAYER_RELU;
+    } else if (hidden_activation == "sigmoid") {
+        activation = LAYER_SIGMOID;
+    } else {
+        std::cerr << "Nieobsługiwana funkcja aktywacji: " << hidden_activation << std::endl;
+        return false;
+    }
+
+    input_size = sizes[0];
+    layers.clear();
+    for (size_t i = 1; i < sizes.size(); ++i) {
+        layers.push_back({LAYER_DENSE, sizes[i]});
+        layers.push_back({i + 1 < sizes.size() ? activation : (softmax_output ? LAYER_SOFTMAX : LAYER_SIGMOID), 0});
+    }
+    return true;
+}
+
+// Gradienty i bufory pośrednie jednej paczki dla LayerStack (każdy wątek uczący ma własne)
+template <typename T>
+struct StackGradients {
+    AlignedBuffer<T> weights;         // Suma gradientów, w tym samym układzie co arena parametrów
+    AlignedBuffer<T> activations;     // Wyniki warstw dla paczki
+    AlignedBuffer<T> error;           // Błąd bieżącej warstwy [batch x szerokość]
+    AlignedBuffer<T> previous_error;  // Błąd przekazywany do warstwy niżej
+    int samples = 0;                  // Liczba próbek zsumowanych w weights
+};
+
+template <typename T>
+class LayerStack {
+public:
+    using Scalar = T;
+    using Gradients = StackGradients<T>;
+
+    // Buduje sieć; po każdej warstwie Dense może wystąpić najwyżej jedna aktywacja.
+    // Te same warstwy i ziarno dają zawsze te same wagi.
+    LayerStack(int input_size, const std::vector<LayerSpec>& specs, uint64_t seed = DEFAULT_SEED) : input_size(input_size) {
+        int width = input_size;
+        size_t weight_offset = 0;
+        size_t output_offset = 0;
+        for (const LayerSpec& spec : specs) {
+            Layer layer;
+            layer.type = spec.type;
+            layer.inputs = width;
+            if (spec.type == LAYER_DENSE) {
+                layer.outputs = spec.size;
+                layer.weights = weight_offset;
+                layer.output = output_offset;
+                weight_offset += alignedCount(static_cast<size_t>(spec.size) * width);
+                output_offset += alignedCount(spec.size);
+                width = spec.size;
+            } else {
+                // Aktywacja działa w miejscu na wyniku ostatniej warstwy Dense
+                layer.outputs = width;
+                layer.weights = 0;
+                layer.output = layers.empty() ? 0 : layers.back().output;
+            }
+            layers.push_back(layer);
+        }
+        output_size = width;
+        activation_size = output_offset;
+        parameters.assign(weight_offset, T(0));
+        activations.assign(activation_size, T(0));
+        output.resize(output_size);
+
+        // Inicjalizacja wag: He przed ReLU, Xavier przed sigmoidem; każda warstwa ma własny strumień liczb losowych
+        uint64_t stream = 0;
+        for (size_t l = 0; l < layers.size(); ++l) {
+            if (layers[l].type == LAYER_DENSE) {
+                bool relu_next = l + 1 < layers.size() && layers[l + 1].type == LAYER_RELU;
+                initializeWeights(&parameters[layers[l].weights], static_cast<size_t>(layers[l].outputs) * layers[l].inputs,
+                                  layers[l].inputs, layers[l].outputs, relu_next ? INIT_HE : INIT_XAVIER, seed, stream++);
+            }
+        }
+    }
+
+    // Forward propagation; zwraca referencję na wynik sieci, ważną do następnego wywołania
+    const std::vector<T>& forward(const std::vector<T>& inputs) {
+        return forward(inputs.data());
+    }
+
+    const std::vector<T>& forward(const T* inputs) {
+        const KernelTable<T>& kt = kernels<T>();
+        const T* in = inputs;
+        for (const Layer& layer : layers) {
+            T* out = &activations[layer.output];
+            if (layer.type == LAYER_DENSE) {
+                const T* w = &parameters[layer.weights];
+                for (int i = 0; i < layer.outputs; ++i) {
+                    out[i] = kt.dot(in, w + static_cast<size_t>(i) * layer.inputs, layer.inputs);  // Suma ważona
+                }
+                in = out;
+            } else {
+                activate(layer, out, layer.outputs);
+            }
+        }
+        std::copy(in, in + output_size, output.begin());
+        return output;
+    }
+
+    // Forward propagation dla paczki: inputs [batch x input_size], outputs [batch x output_size]
+    void forwardBatch(const T* inputs, int batch, T* outputs) {
+        const T* result = forwardBatch(inputs, batch, batch_grad);
+        std::copy(result, result + static_cast<size_t>(batch) * output_size, outputs);
+    }
+
+    // Uczenie na jednej próbce (paczka o rozmiarze 1)
+    void train(const std::vector<T>& inputs, const std::vector<T>& expected_output, T learning_rate) {
+        train(inputs.data(), expected_output.data(), learning_rate);
+    }
+
+    void train(const T* inputs, const T* expected_output, T learning_rate) {
+        trainBatch(inputs, expected_output, 1, learning_rate);
+    }
+
+    void trainBatch(const T* inputs, const T* expected_output, int batch, T learning_rate) {
+        computeGradients(inputs, expected_output, batch, batch_grad);
+        beginStep();
+        const Gradients* grads[] = {&batch_grad};
+        applyGradients(grads, 1, learning_rate, 0, parameterCount());
+    }
+
+    // Liczy sumę gradientów paczki do grad, nie zmieniając wag (bezpieczne dla wielu wątków naraz).
+    // Wyjście sigmoid w ostatniej warstwie łączone jest z entropią krzyżową: błąd to po prostu
+    // (oczekiwane - wynik), tak jak w SimpleNN. Pozostałe aktywacje mnożą błąd przez swoją pochodną.
+    void computeGradients(const T* inputs, const T* expected_output, int batch, Gradients& grad) const {
+        grad.weights.assign(parameters.size(), T(0));
+        grad.samples = batch;
+        if (batch == 0) {
+            return;
+        }
+        TELEMETRY_PHASE("forward");
+        const T* result = forwardBatch(inputs, batch, grad);
+        TELEMETRY_NEXT_PHASE("backprop");
+
+        size_t max_width = input_size;
+        for (const Layer& layer : layers) {
+            max_width = std::max<size_t>(max_width, layer.outputs);
+        }
+        grad.error.resize(static_cast<size_t>(batch) * max_width);
+        grad.previous_error.resize(static_cast<size_t>(batch) * max_width);
+
+        T* error = grad.error.data();
+        T* previous_error = grad.previous_error.data();
+        for (size_t i = 0; i < static_cast<size_t>(batch) * output_size; ++i) {
+            error[i] = expected_output[i] - result[i];
+        }
+
+        for (size_t l = layers.size(); l-- > 0;) {
+            const Layer& layer = layers[l];
+            size_t count = static_cast<size_t>(batch) * layer.outputs;
+            const T* values = &grad.activations[static_cast<size_t>(batch) * layer.output];
+            if (layer.type == LAYER_RELU) {
+                for (size_t i = 0; i < count; ++i) {
+                    error[i] *= values[i] > 0 ? 1 : 0;  // Pochodna ReLU
+                }
+            } else if (layer.type == LAYER_SOFTMAX) {
+                continue;  // Softmax (zawsze ostatni) z entropią krzyżową: błąd to już (oczekiwane - wynik)
+            } else if (layer.type == LAYER_SIGMOID) {
+                if (l + 1 == layers.size()) {
+                    continue;  // Sigmoid z entropią krzyżową: pochodna się skraca
+                }
+                for (size_t i = 0; i < count; ++i) {
+                    error[i] *= values[i] * (T(1) - values[i]);  // Pochodna sigmoid
+                }
+            } else {
+                const T* layer_input = layerInput(l, inputs, batch, grad);
+                gemmTN(error, layer_input, &grad.weights[layer.weights], layer.outputs, layer.inputs, batch, T(1));
+                if (l > 0) {
+                    // Błąd warstwy niżej: [batch x outputs] * [outputs x inputs]
+                    gemmNN(error, &parameters[layer.weights], previous_error, batch, layer.inputs, layer.outputs);
+                    std::swap(error, previous_error);
+                }
+            }
+        }
+    }
+
+    // Zmienia wagi o średni gradient z count buforów, tylko dla parametrów [begin, end) areny
+    void applyGradients(const Gradients* const* grads, int count, T learning_rate, size_t begin, size_t end) {
+        TELEMETRY_SCOPE("update");
+        T scale = averageScale<T>(grads, count);
+        if (scale == 0) {
+            return;
+        }
+        for (size_t i = begin; i < end; ++i) {
+            T sum = 0;
+            for (int g = 0; g < count; ++g) {
+                sum += grads[g]->weights[i];
+            }
+            parameters[i] += optimizer.delta(i, sum * scale, learning_rate);
+        }
+    }
+
+    void setOptimizer(const OptimizerSettings& settings) { optimizer.configure(settings, parameterCount()); }
+    OptimizerType optimizerType() const { return optimizer.type(); }
+
+    // Początek kroku uczenia: raz przed applyGradients dla wszystkich zakresów parametrów
+    void beginStep() { optimizer.beginStep(); }
+
+    // Rozmiar areny parametrów (razem z wyrównaniem warstw do 64 bajtów)
+    size_t parameterCount() const { return parameters.size(); }
+
+    int inputSize() const { return input_size; }
+    int outputSize() const { return output_size; }
+
+    // Opis sieci, np. "100 -> Dense 30 -> ReLU -> Dense 1 -> sigmoid"
+    std::string describe() const {
+        std::string text = std::to_string(input_size);
+        for (const Layer& layer : layers) {
+            if (layer.type == LAYER_DENSE) {
+                text += " -> Dense " + std::to_string(layer.outputs);
+            } else {
+                text += layer.type == LAYER_RELU ? " -> ReLU" : layer.type == LAYER_SOFTMAX ? " -> softmax" : " -> sigmoid";
+            }
+        }
+        return text;
+    }
+
+    // Zapis wag warstwa po warstwie, jedna liczba w linii (dla 100-30-1 ten sam plik co SimpleNN::saveWeights)
+    void saveWeights(const std::string& filename) {
+        TELEMETRY_SCOPE("save_weights");
+        std::ofstream file(filename);
+        if (!file.is_open()) {
+            std::cerr << "Could not open file for writing." << std::endl;
+            return;
+        }
+        file.precision(std::numeric_limits<T>::max_digits10);
+        for (const Layer& layer : layers) {
+            if (layer.type == LAYER_DENSE) {
+                const T* w = &parameters[layer.weights];
+                for (size_t i = 0; i < static_cast<size_t>(layer.outputs) * layer.inputs; ++i) {
+                    file << w[i] << "\n";
+                }
+            }
+        }
+    }
+
+    // Wczytuje wagi zapisane przez saveWeights; false, gdy liczba wag nie zgadza się z siecią.
+    // Wagi czytane są do kopii areny, więc przy błędzie sieć zachowuje poprzednie wagi.
+    bool loadWeights(const std::string& filename) {
+        std::ifstream file(filename);
+        if (!file.is_open()) {
+            std::cerr << "Could not open file for reading." << std::endl;
+            return false;
+        }
+        AlignedBuffer<T> loaded(parameters.size(), T(0));
+        size_t expected = 0;
+        for (const Layer& layer : layers) {
+            if (layer.type == LAYER_DENSE) {
+                T* w = &loaded[layer.weights];
+                size_t count = static_cast<size_t>(layer.outputs) * layer.inputs;
+                for (size_t i = 0; i < count; ++i) {
+                    file >> w[i];
+                }
+                expected += count;
+            }
+        }
+        T extra;
+        bool ok = !file.fail() && !(file >> extra);  // Wszystkie wagi wczytane i nic nie zostało
+        if (!ok) {
+            std::cerr << "Plik " << filename << " nie zawiera " << expected << " wag." << std::endl;
+            return false;
+        }
+        parameters.swap(loaded);
+        return true;
+    }
+
+private:
+    struct Layer {
+        LayerType type;
+        int inputs;      // Szerokość wejścia warstwy
+        int outputs;     // Szerokość wyniku warstwy
+        size_t weights;  // Początek wag warstwy Dense w arenie parametrów
+        size_t output;   // Początek wyniku w buforze aktywacji (dla paczki mnożony przez batch)
+    };
+
+    int input_size;
+    int output_size;
+    size_t activation_size;        // Suma (wyrównanych) szerokości wszystkich warstw Dense
+    std::vector<Layer> layers;
+    AlignedBuffer<T> parameters;   // Arena wag wszystkich warstw
+    AlignedBuffer<T> activations;  // Wyniki warstw dla jednej próbki
+    std::vector<T> output;         // Kopia wyniku zwracana przez forward
+    Gradients batch_grad;          // Bufory dla train/trainBatch/forwardBatch wywoływanych na samej sieci
+    Optimizer<T> optimizer;        // Stan momentum/Adam dla applyGradients
+
+    // Liczba elementów zaokrąglona w górę do wielokrotności 64 bajtów
+    static size_t alignedCount(size_t count) {
+        const size_t per_line = 64 / sizeof(T);
+        return (count + per_line - 1) / per_line * per_line;
+    }
+
+    static void activate(const Layer& layer, T* values, size_t count) {
+        if (layer.type == LAYER_RELU) {
+            kernels<T>().relu(values, static_cast<int>(count));
+        } else if (layer.type == LAYER_SOFTMAX) {
+            softmaxRows(values, static_cast<int>(count / layer.outputs), layer.outputs);
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                values[i] = T(1) / (T(1) + std::exp(-values[i]));
+            }
+        }
+    }
+
+    // Wejście warstwy l dla paczki: wynik poprzedniej warstwy Dense albo wejście sieci
+    const T* layerInput(size_t l, const T* inputs, int batch, const Gradients& grad) const {
+        for (size_t k = l; k-- > 0;) {
+            if (layers[k].type == LAYER_DENSE) {
+                return &grad.activations[static_cast<size_t>(batch) * layers[k].output];
+            }
+        }
+        return inputs;
+    }
+
+    // Forward propagation paczki z wynikami warstw w grad.activations; zwraca wskaźnik na wynik sieci
+    const T* forwardBatch(const T* inputs, int batch, Gradients& grad) const {
+        grad.activations.resize(static_cast<size_t>(batch) * activation_size);
+        const T* in = inputs;
+        for (const Layer& layer : layers) {
+            T* out = &grad.activations[static_cast<size_t>(batch) * layer.output];
+            if (layer.type == LAYER_DENSE) {
+                gemmNT(in, &parameters[layer.weights], out, batch, layer.outputs, layer.inputs);
+                in = out;
+            } else {
+                activate(layer, out, static_cast<size_t>(batch) * layer.outputs);
+            }
+        }
+        return in;
+    }
+};
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef XOCZY_OPTIMIZER_H
+#define XOCZY_OPTIMIZER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "dataset.h"
+
+// Sposób zmiany wag i harmonogram współczynnika uczenia.
+//
+// Sieci w tym projekcie sumują w gradientach kierunek zmiany wag (oczekiwane - wynik),
+// a nie gradient funkcji błędu, więc krok to zawsze w += lr * kierunek.
+// Kierunek to średnia po wszystkich próbkach kroku (averageScale): suma z paczek wszystkich wątków
+// dzielona przez liczbę próbek. Dzięki temu --batch i --threads nie zmieniają wielkości kroku,
+// a przy paczce jednej próbki krok jest taki sam jak w uczeniu próbka po próbce.
+// SGD: krok wprost z kierunku. Momentum: kierunek uśredniany wykładniczo (prędkość),
+// dzięki czemu kolejne kroki w tę samą stronę się sumują. Adam: kierunek dzielony przez
+// pierwiastek ze średniego kwadratu, więc każda waga ma własny, samodostosowujący się krok.
+
+enum OptimizerType {
+    OPTIMIZER_SGD,
+    OPTIMIZER_MOMENTUM,
+    OPTIMIZER_ADAM,
+};
+
+struct OptimizerSettings {
+    OptimizerType type = OPTIMIZER_SGD;
+    double momentum = 0.9;   // Momentum: udział poprzedniej prędkości
+    double beta1 = 0.9;      // Adam: wygaszanie średniej kierunku
+    double beta2 = 0.999;    // Adam: wygaszanie średniej kwadratu
+    double epsilon = 1e-8;   // Adam: zabezpieczenie przed dzieleniem przez zero
+};
+
+inline bool parseOptimizer(const std::string& name, OptimizerType& type) {
+    if (name == "sgd") {
+        type = OPTIMIZER_SGD;
+    } else if (name == "momentum") {
+        type = OPTIMIZER_MOMENTUM;
+    } else if (name == "adam") {
+        type = OPTIMIZER_ADAM;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Stan optymalizatora: osobne wartości dla każdego parametru sieci.
+// delta dla rozłącznych zakresów parametrów może być liczona równolegle przez różne wątki.
+template <typename T>
+class Optimizer {
+public:
+    void configure(const OptimizerSettings& optimizer_settings, size_t parameters) {
+        settings = optimizer_settings;
+        steps = 0;
+        first_moment.assign(settings.type == OPTIMIZER_SGD ? 0 : parameters, T(0));
+        second_moment.assign(settings.type == OPTIMIZER_ADAM ? parameters : 0, T(0));
+    }
+
+    OptimizerType type() const { return settings.type; }
+
+    // Wołane raz na krok uczenia, przed delta dla wszystkich parametrów
+    void beginStep() {
+        ++steps;
+        if (settings.type == OPTIMIZER_ADAM) {
+            // Korekta obciążenia średnich zaczynających od zera
+            first_correction = static_cast<T>(1 / (1 - std::pow(settings.beta1, steps)));
+            second_correction = static_cast<T>(1 / (1 - std::pow(settings.beta2, steps)));
+        }
+    }
+
+    // Zmiana wagi i dla kierunku direction (suma z paczki)
+    T delta(size_t i, T direction, T learning_rate) {
+        switch (settings.type) {
+        case OPTIMIZER_MOMENTUM:
+            first_moment[i] = flushTiny(static_cast<T>(settings.momentum) * first_moment[i] + direction);
+            return learning_rate * first_moment[i];
+        case OPTIMIZER_ADAM: {
+            T beta1 = static_cast<T>(settings.beta1);
+            T beta2 = static_cast<T>(settings.beta2);
+            first_moment[i] = flushTiny(beta1 * first_moment[i] + (1 - beta1) * direction);
+            second_moment[i] = flushTiny(beta2 * second_moment[i] + (1 - beta2) * direction * direction);
+            T m = first_moment[i] * first_correction;
+            T v = second_moment[i] * second_correction;
+            return learning_rate * m / (std::sqrt(v) + static_cast<T>(settings.epsilon));
+        }
+        default:
+            return learning_rate * direction;
+        }
+    }
+
+private:
+    // Średnie wag martwych neuronów ReLU wygasają geometrycznie do liczb zdenormalizowanych,
+    // na których każde działanie jest kilkadziesiąt razy wolniejsze; zerujemy je wcześniej
+    static T flushTiny(T value) { return std::abs(value) < T(1e-30) ? T(0) : value; }
+
+    OptimizerSettings settings;
+    long long steps = 0;
+    T first_correction = 1;
+    T second_correction = 1;
+    AlignedBuffer<T> first_moment;   // Momentum: prędkość; Adam: średnia kierunku
+    AlignedBuffer<T> second_moment;  // Adam: średnia kwadratu kierunku
+};
+
+// Mnożnik zamieniający sumę gradientów z count buforów w średnią po ich próbkach (0, gdy nie ma próbek).
+// Gradients to BatchGradients albo StackGradients - każdy bufor z polem samples.
+template <typename T, typename Gradients>
+T averageScale(const Gradients* const* grads, int count) {
+    int samples = 0;
+    for (int g = 0; g < count; ++g) {
+        samples += grads[g]->samples;
+    }
+    return samples > 0 ? T(1) / samples : T(0);
+}
+
+// Harmonogram współczynnika uczenia w funkcji numeru epoki
+enum LearningRateSchedule {
+    SCHEDULE_CONSTANT,  // Stały przez całe uczenie
+    SCHEDULE_STEP,      // Połowa co ćwierć budżetu epok
+    SCHEDULE_COSINE,    // Od pełnego do zera po cosinusie przez cały budżet epok
+};
+
+inline bool parseSchedule(const std::string& name, LearningRateSchedule& schedule) {
+    if (name == "constant") {
+        schedule = SCHEDULE_CONSTANT;
+    } else if (name == "step") {
+        schedule = SCHEDULE_STEP;
+    } else if (name == "cosine") {
+        schedule = SCHEDULE_COSINE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline double scheduledLearningRate(LearningRateSchedule schedule, double base, int epoch, int epochs) {
+    switch (schedule) {
+    case SCHEDULE_STEP:
+        return base * std::pow(0.5, epoch / std::max(1, epochs / 4));
+    case SCHEDULE_COSINE:
+        return base * 0.5 * (1 + std::cos(3.14159265358979323846 * epoch / std::max(1, epochs)));
+    default:
+        return base;
+    }
+}
+
+#endif
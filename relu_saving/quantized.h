@@ -0,0 +1,326 @@
+#ifndef XOCZY_QUANTIZED_H
+#define XOCZY_QUANTIZED_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <immintrin.h>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "dataset.h"
+#include "model_file.h"
+#include "simple_nn.h"
+#include "softmax.h"
+
+// Iloczyn skalarny liczb int8 z akumulacją w int32
+inline int32_t dotInt8Scalar(const int8_t* a, const int8_t* b, int n) {
+    int32_t sum = 0;
+    for (int i = 0; i < n; ++i) {
+        sum += int32_t(a[i]) * int32_t(b[i]);
+    }
+    return sum;
+}
+
+// Wersja AVX2: 16 par int8 rozszerzanych do int16 i mnożonych parami z sumowaniem (vpmaddwd)
+__attribute__((target("avx2")))
+inline int32_t dotInt8Avx2(const int8_t* a, const int8_t* b, int n) {
+    __m256i sum = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+        __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(va, vb));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    int32_t total = _mm_cvtsi128_si32(half);
+    for (; i < n; ++i) {
+        total += int32_t(a[i]) * int32_t(b[i]);
+    }
+    return total;
+}
+
+using DotInt8 = int32_t (*)(const int8_t*, const int8_t*, int);
+
+inline DotInt8 selectDotInt8() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? dotInt8Avx2 : dotInt8Scalar;
+}
+
+// Zaokrągla value / scale (podane jako iloczyn z odwrotnością skali) do int8, z nasyceniem do [-127, 127].
+// Bez lround i dzielenia, więc pętla po pikselach w forward się wektoryzuje.
+inline int8_t quantizeScaled(double scaled) {
+    double clamped = std::max(-127.0, std::min(127.0, scaled));
+    return static_cast<int8_t>(clamped + (clamped >= 0 ? 0.5 : -0.5));
+}
+
+// Zamienia liczbę rzeczywistą na int8 przy danej skali (wartość = q * scale), z nasyceniem do [-127, 127]
+inline int8_t quantize(double value, double scale) { return quantizeScaled(value / scale); }
+
+// Nagłówek pliku model.int8. Za nim wagi int8: wejście->ukryta [hidden x input], od razu po nich ukryta->wyjście [output x hidden].
+struct QuantizedHeader {
+    char magic[4];               // "XOQ8"
+    uint32_t version;            // QUANTIZED_VERSION
+    uint32_t input_size;
+    uint32_t hidden_size;
+    uint32_t output_size;
+    uint32_t output_activation;  // ModelActivation warstwy wyjściowej
+    double input_scale;          // Skale jak w QuantizedNN
+    double hidden_scale;
+    double input_hidden_scale;
+    double hidden_output_scale;
+    uint64_t checksum;           // FNV-1a 64 wszystkich bajtów za nagłówkiem
+};
+static_assert(sizeof(QuantizedHeader) == 64, "Nagłówek modelu int8 musi mieć 64 bajty");
+
+const char QUANTIZED_MAGIC[4] = {'X', 'O', 'Q', '8'};
+const uint32_t QUANTIZED_VERSION = 1;
+
+// Sieć po kwantyzacji do int8 (post-training quantization), tylko do wykrywania.
+// Wagi każdej warstwy mają jedną symetryczną skalę (max |w| / 127).
+// Skale wejścia i warstwy ukrytej dobierane są na zbiorze kalibracyjnym
+// (największa wartość, jaka pojawia się na danych treningowych).
+// Mnożenia liczone są na liczbach całkowitych, do liczb rzeczywistych wracamy raz na neuron.
+// Kalibracja odbywa się raz (po uczeniu albo przy --convert), a wykrywanie wczytuje gotowe skale z model.int8.
+class QuantizedNN {
+public:
+    QuantizedNN() : dot(selectDotInt8()) {}
+
+    template <typename T>
+    QuantizedNN(const BasicNN<T>& nn, const Dataset& calibration)
+        : input_size(nn.inputSize()), hidden_size(nn.hiddenSize()), output_size(nn.outputSize()),
+          output_activation(nn.outputActivation()), input_q(input_size), hidden_q(hidden_size), output(output_size),
+          dot(selectDotInt8()) {
+        const std::vector<T>& w1 = nn.inputHiddenWeights();
+        const std::vector<T>& w2 = nn.hiddenOutputWeights();
+
+        input_hidden_scale = maxAbs(w1.begin(), w1.end()) / 127.0;
+        hidden_output_scale = maxAbs(w2.begin(), w2.end()) / 127.0;
+        for (T w : w1) {
+            input_hidden_weights.push_back(quantize(w, input_hidden_scale));
+        }
+        for (T w : w2) {
+            hidden_output_weights.push_back(quantize(w, hidden_output_scale));
+        }
+
+        // Kalibracja: zakres wejść i aktywacji warstwy ukrytej liczony w pełnej precyzji
+        double input_max = 0;
+        double hidden_max = 0;
+        for (size_t s = 0; s < calibration.size(); ++s) {
+            const double* x = calibration.sample(s);
+            input_max = std::max(input_max, maxAbs(x, x + input_size));
+            for (int i = 0; i < hidden_size; ++i) {
+                double sum = 0;
+                for (int j = 0; j < input_size; ++j) {
+                    sum += x[j] * w1[i * input_size + j];
+                }
+                hidden_max = std::max(hidden_max, sum);  // ReLU: liczy się tylko część dodatnia
+            }
+        }
+        input_scale = input_max > 0 ? input_max / 127.0 : 1.0;
+        hidden_scale = hidden_max > 0 ? hidden_max / 127.0 : 1.0;
+    }
+
+    const std::vector<double>& forward(const std::vector<double>& inputs) {
+        return forward(inputs.data());
+    }
+
+    // Forward propagation na liczbach int8; wynik w postaci rzeczywistej (po sigmoidzie albo softmaksie)
+    const std::vector<double>& forward(const double* inputs) {
+        const double to_input = 1.0 / input_scale;
+        for (int j = 0; j < input_size; ++j) {
+            input_q[j] = quantizeScaled(inputs[j] * to_input);
+        }
+
+        // Warstwa ukryta: suma int32, przeskalowanie, ReLU i ponowna kwantyzacja do int8
+        double to_real = input_scale * input_hidden_scale;
+        const double to_hidden = to_real / hidden_scale;
+        for (int i = 0; i < hidden_size; ++i) {
+            int32_t acc = dot(input_q.data(), &input_hidden_weights[static_cast<size_t>(i) * input_size], input_size);
+            hidden_q[i] = acc > 0 ? quantizeScaled(acc * to_hidden) : 0;
+        }
+
+        // Warstwa wyjściowa: suma int32, potem sigmoid albo softmax w liczbach rzeczywistych
+        to_real = hidden_scale * hidden_output_scale;
+        for (int i = 0; i < output_size; ++i) {
+            int32_t acc = dot(hidden_q.data(), &hidden_output_weights[i * hidden_size], hidden_size);
+            output[i] = acc * to_real;
+        }
+        if (output_activation == OUTPUT_SOFTMAX) {
+            softmaxRows(output.data(), 1, output_size);
+        } else {
+            for (int i = 0; i < output_size; ++i) {
+                output[i] = 1.0 / (1.0 + std::exp(-output[i]));
+            }
+        }
+        return output;
+    }
+
+    // Paczka obrazów [batch x input_size]; wyniki [batch x output_size]. Obrazy liczone kolejno, bez alokacji.
+    void forwardBatch(const double* inputs, int batch, double* outputs) {
+        for (int b = 0; b < batch; ++b) {
+            forward(inputs + static_cast<size_t>(b) * input_size);
+            std::copy(output.begin(), output.end(), outputs + static_cast<size_t>(b) * output_size);
+        }
+    }
+
+    // k najlepszych klas dla każdego obrazu paczki; wynik [batch x k]
+    void topKBatch(const double* inputs, int batch, int k, ClassScore* top) {
+        for (int b = 0; b < batch; ++b) {
+            forward(inputs + static_cast<size_t>(b) * input_size);
+            selectTopK(output.data(), output_size, k, top + static_cast<size_t>(b) * k);
+        }
+    }
+
+    int inputSize() const { return input_size; }
+    int hiddenSize() const { return hidden_size; }
+    int outputSize() const { return output_size; }
+    OutputActivation outputActivation() const { return output_activation; }
+
+    // Rozmiar wag w bajtach (do porównania z wersją double)
+    size_t weightBytes() const { return input_hidden_weights.size() + hidden_output_weights.size(); }
+
+    bool save(const std::string& filename) const {
+        TELEMETRY_SCOPE("save_model");
+        QuantizedHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, QUANTIZED_MAGIC, sizeof(QUANTIZED_MAGIC));
+        header.version = QUANTIZED_VERSION;
+        header.input_size = input_size;
+        header.hidden_size = hidden_size;
+        header.output_size = output_size;
+        header.output_activation = output_activation == OUTPUT_SOFTMAX ? ACTIVATION_SOFTMAX : ACTIVATION_SIGMOID;
+        header.input_scale = input_scale;
+        header.hidden_scale = hidden_scale;
+        header.input_hidden_scale = input_hidden_scale;
+        header.hidden_output_scale = hidden_output_scale;
+
+        std::vector<unsigned char> body(input_hidden_weights.begin(), input_hidden_weights.end());
+        body.insert(body.end(), hidden_output_weights.begin(), hidden_output_weights.end());
+        header.checksum = modelChecksum(body.data(), body.size());
+
+        std::ofstream file(filename, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Nie można zapisać modelu " << filename << std::endl;
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(body.data()), body.size());
+        return file.good();
+    }
+
+    // Wczytuje model.int8; przy błędzie sieć zostaje bez zmian
+    bool load(const std::string& filename) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Nie można otworzyć modelu " << filename << " (zapisywany po uczeniu albo przez --convert z --int8)." << std::endl;
+            return false;
+        }
+        std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        QuantizedHeader header;
+        if (bytes.size() < sizeof(header)) {
+            std::cerr << "Plik " << filename << " nie jest modelem int8." << std::endl;
+            return false;
+        }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        const unsigned char* body = bytes.data() + sizeof(header);
+        size_t body_size = bytes.size() - sizeof(header);
+        uint64_t w1_count = uint64_t(header.hidden_size) * header.input_size;
+        uint64_t w2_count = uint64_t(header.output_size) * header.hidden_size;
+        auto positive = [](double scale) { return std::isfinite(scale) && scale > 0; };
+        if (std::memcmp(header.magic, QUANTIZED_MAGIC, sizeof(QUANTIZED_MAGIC)) != 0 || header.version != QUANTIZED_VERSION
+            || header.input_size == 0 || header.hidden_size == 0 || header.output_size == 0 || w1_count + w2_count != body_size
+            || !positive(header.input_scale) || !positive(header.hidden_scale) || !positive(header.input_hidden_scale)
+            || !positive(header.hidden_output_scale) || modelChecksum(body, body_size) != header.checksum) {
+            std::cerr << "Plik " << filename << " nie jest poprawnym modelem int8." << std::endl;
+            return false;
+        }
+
+        input_size = header.input_size;
+        hidden_size = header.hidden_size;
+        output_size = header.output_size;
+        output_activation = header.output_activation == ACTIVATION_SOFTMAX ? OUTPUT_SOFTMAX : OUTPUT_SIGMOID;
+        input_scale = header.input_scale;
+        hidden_scale = header.hidden_scale;
+        input_hidden_scale = header.input_hidden_scale;
+        hidden_output_scale = header.hidden_output_scale;
+        const int8_t* weights = reinterpret_cast<const int8_t*>(body);
+        input_hidden_weights.assign(weights, weights + w1_count);
+        hidden_output_weights.assign(weights + w1_count, weights + w1_count + w2_count);
+        input_q.assign(input_size, 0);
+        hidden_q.assign(hidden_size, 0);
+        output.assign(output_size, 0);
+        return true;
+    }
+
+private:
+    int input_size = 0;
+    int hidden_size = 0;
+    int output_size = 0;
+    OutputActivation output_activation = OUTPUT_SIGMOID;
+    double input_scale = 1;          // Skala wejścia (kalibrowana)
+    double hidden_scale = 1;         // Skala aktywacji warstwy ukrytej (kalibrowana)
+    double input_hidden_scale = 1;   // Skala wag wejście->ukryta
+    double hidden_output_scale = 1;  // Skala wag ukryta->wyjście
+    std::vector<int8_t> input_hidden_weights;   // [hidden x input]
+    std::vector<int8_t> hidden_output_weights;  // [output x hidden]
+    std::vector<int8_t> input_q;   // Bufor na skwantyzowane wejście
+    std::vector<int8_t> hidden_q;  // Bufor na skwantyzowaną warstwę ukrytą
+    std::vector<double> output;
+    DotInt8 dot;
+
+    template <typename It>
+    static double maxAbs(It begin, It end) {
+        double result = 0;
+        for (It it = begin; it != end; ++it) {
+            result = std::max(result, std::fabs(static_cast<double>(*it)));
+        }
+        return result > 0 ? result : 1.0;
+    }
+};
+
+// Porównuje sieć int8 z siecią w pełnej precyzji na zbiorze data:
+// różnica wyników oraz trafność obu sieci przy progu 0.5
+template <typename T>
+void reportQuantization(BasicNN<T>& nn, QuantizedNN& quantized, const Dataset& data) {
+    double max_delta = 0;
+    double sum_delta = 0;
+    int correct_full = 0;
+    int correct_int8 = 0;
+    for (size_t s = 0; s < data.size(); ++s) {
+        std::vector<T> input(data.sample(s), data.sample(s) + data.inputSize());
+        const std::vector<T>& full = nn.forward(input);
+        const std::vector<double>& q = quantized.forward(data.sample(s));
+        for (int i = 0; i < nn.outputSize(); ++i) {
+            double delta = std::fabs(full[i] - q[i]);
+            max_delta = std::max(max_delta, delta);
+            sum_delta += delta / nn.outputSize();
+        }
+        const double* label = data.label(s);
+        if (nn.outputActivation() == OUTPUT_SOFTMAX) {
+            // Klasyfikator: trafienie, gdy najbardziej prawdopodobna klasa to klasa z etykiety
+            int expected = std::max_element(label, label + nn.outputSize()) - label;
+            correct_full += std::max_element(full.begin(), full.end()) - full.begin() == expected;
+            correct_int8 += std::max_element(q.begin(), q.end()) - q.begin() == expected;
+        } else {
+            bool expected = label[0] >= 0.5;
+            correct_full += (full[0] >= 0.5) == expected;
+            correct_int8 += (q[0] >= 0.5) == expected;
+        }
+    }
+    size_t count = std::max<size_t>(1, data.size());
+    std::cout << "Kwantyzacja int8: wagi " << quantized.weightBytes() << " B zamiast "
+              << nn.parameterCount() * sizeof(T) << " B" << std::endl;
+    std::cout << "Różnica wyników: średnia " << sum_delta / count << ", maks. " << max_delta << std::endl;
+    std::cout << "Trafność: pełna precyzja " << 100.0 * correct_full / count << "%, int8 "
+              << 100.0 * correct_int8 / count << "% (zmiana "
+              << 100.0 * (correct_int8 - correct_full) / count << " p.p.)" << std::endl;
+}
+
+#endif
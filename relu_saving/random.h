@@ -0,0 +1,104 @@
+#ifndef XOCZY_RANDOM_H
+#define XOCZY_RANDOM_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Liczby losowe z jawnym ziarnem zamiast globalnego rand().
+//
+// counterRandom(seed, stream, counter) to generator licznikowy: liczba zależy tylko od ziarna,
+// numeru strumienia (np. warstwy) i numeru kolejnego elementu, a nie od tego, który wątek
+// i w jakiej kolejności ją liczy. Dzięki temu wagi zainicjalizowane równolegle są identyczne
+// bit w bit dla każdej liczby wątków.
+// Xoshiro256 to zwykły szybki generator sekwencyjny dla jednego wątku (np. dane syntetyczne).
+
+const uint64_t DEFAULT_SEED = 1;
+
+// Mieszanie SplitMix64: każda zmiana bitu wejścia zmienia średnio połowę bitów wyniku
+inline uint64_t splitMix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+inline uint64_t counterRandom(uint64_t seed, uint64_t stream, uint64_t counter) {
+    return splitMix64(splitMix64(seed ^ splitMix64(stream)) + counter);
+}
+
+// Liczba z przedziału [0, 1) z 53 najstarszych bitów
+inline double toUnit(uint64_t bits) {
+    return (bits >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// xoshiro256** (Blackman, Vigna); stan startowy z ziarna i numeru strumienia przez SplitMix64
+class Xoshiro256 {
+public:
+    explicit Xoshiro256(uint64_t seed, uint64_t stream = 0) {
+        uint64_t x = seed ^ splitMix64(stream);
+        for (uint64_t& word : state) {
+            x += 0x9E3779B97F4A7C15ULL;
+            word = splitMix64(x);
+        }
+    }
+
+    uint64_t next() {
+        uint64_t result = rotl(state[1] * 5, 7) * 9;
+        uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+
+    // Liczba z przedziału [0, 1)
+    double uniform() { return toUnit(next()); }
+
+private:
+    uint64_t state[4];
+
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+};
+
+// Sposób losowania wag warstwy
+enum WeightInit {
+    INIT_XAVIER,  // U(-a, a), a = sqrt(6 / (wejścia + wyjścia)) - dla sigmoid
+    INIT_HE,      // U(-a, a), a = sqrt(6 / wejścia) - dla ReLU
+};
+
+// Od tylu wag inicjalizacja dzielona jest między wątki
+const size_t PARALLEL_INIT_MIN = 1 << 20;
+
+// Losuje count wag warstwy o fan_in wejściach i fan_out wyjściach.
+// Waga nr k zależy tylko od (seed, stream, k), więc wynik nie zależy od liczby wątków.
+template <typename T>
+void initializeWeights(T* weights, size_t count, int fan_in, int fan_out, WeightInit init, uint64_t seed, uint64_t stream) {
+    double limit = init == INIT_HE ? std::sqrt(6.0 / fan_in) : std::sqrt(6.0 / (fan_in + fan_out));
+    auto fill = [=](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            weights[k] = static_cast<T>((toUnit(counterRandom(seed, stream, k)) * 2 - 1) * limit);
+        }
+    };
+
+    int threads = count >= PARALLEL_INIT_MIN ? static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) : 1;
+    if (threads == 1) {
+        fill(0, count);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back(fill, count * t / threads, count * (t + 1) / threads);
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+#endif
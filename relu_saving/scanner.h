@@ -0,0 +1,240 @@
+#ifndef XOCZY_SCANNER_H
+#define XOCZY_SCANNER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "dataset.h"
+#include "kernels.h"
+#include "simple_nn.h"
+#include "trainer.h"
+
+// Wykrywanie wzoru na dużym obrazie binarnym (np. 4096x4096): sieć 10x10 przykładana w każdym położeniu.
+//
+// Zamiast osobnego forward dla każdego okna (100 mnożeń na neuron ukryty) liczymy warstwę ukrytą
+// jak splot: każdy zapalony piksel dodaje swoją kolumnę wag do wszystkich okien, które go zawierają.
+// Wagi są przestawione do układu [piksel okna][neuron ukryty], więc jeden piksel i jedno okno
+// to jedno dodanie wektora 30 wag (axpy). Zgaszone piksele nic nie kosztują.
+//
+// Obraz czytany jest pasami wierszy: w pamięci jest tylko pas (plus window-1 wierszy zakładki),
+// zapisany jako listy kolumn zapalonych pikseli. W ramach pasa kolumny okien podzielone są
+// na kafelki liczone równolegle.
+
+struct ScanStats {
+    int width = 0;          // Szerokość obrazu
+    int height = 0;         // Wysokość obrazu
+    size_t windows = 0;     // Liczba ocenionych okien
+    size_t hits = 0;        // Liczba okien z wynikiem >= próg
+    double seconds = 0;     // Czas całego skanowania (z odczytem obrazu)
+};
+
+class WindowScanner {
+public:
+    // Sieć musi mieć kwadratowe wejście (window x window) i jedno wyjście
+    WindowScanner(const SimpleNN& nn, int threads, int tile_width = 64)
+        : window(static_cast<int>(std::lround(std::sqrt(nn.inputSize())))), hidden_size(nn.hiddenSize()),
+          tile_width(std::max(1, tile_width)), pool(threads),
+          output_weights(nn.hiddenOutputWeights().begin(), nn.hiddenOutputWeights().end()), buffers(pool.size()) {
+        // Przestawienie wag z [neuron][piksel] na [piksel][neuron]
+        const std::vector<double>& w1 = nn.inputHiddenWeights();
+        int pixels = window * window;
+        pixel_weights.resize(static_cast<size_t>(pixels) * hidden_size);
+        for (int i = 0; i < hidden_size; ++i) {
+            for (int p = 0; p < pixels; ++p) {
+                pixel_weights[static_cast<size_t>(p) * hidden_size + i] = w1[static_cast<size_t>(i) * pixels + p];
+            }
+        }
+    }
+
+    bool validNetwork(const SimpleNN& nn) const {
+        return window * window == nn.inputSize() && nn.outputSize() == 1;
+    }
+
+    // Skanuje obraz tekstowy (wiersze znaków '0'/'1') pasami po band_rows wierszy wyników.
+    // Okna z wynikiem >= threshold wypisywane są do hits jako "x,y,wynik" (lewy górny róg okna).
+    // Jeśli heatmap nie jest pusty, zapisywana jest tam mapa wyników jako obraz PGM (0-255).
+    bool scan(std::istream& in, int band_rows, double threshold, std::ostream& hits, const std::string& heatmap, ScanStats& stats) {
+        auto start = std::chrono::steady_clock::now();
+        band_rows = std::max(1, band_rows);
+        stats = ScanStats();
+        rows.clear();
+
+        std::ofstream map;
+        std::streampos height_position;
+        hits << "x,y,score\n";
+        hits.precision(6);
+
+        int first_row = 0;  // Numer obrazu pierwszego wiersza w rows
+        bool end_of_image = false;
+        std::string line;
+        while (!end_of_image) {
+            // Doczytanie wierszy, aż w pamięci będzie cały pas z zakładką
+            while (static_cast<int>(rows.size()) < band_rows + window - 1) {
+                if (!std::getline(in, line)) {
+                    end_of_image = true;
+                    break;
+                }
+                if (!parseRow(line, stats)) {
+                    return false;
+                }
+            }
+            if (stats.width < window) {
+                std::cerr << "Obraz jest węższy niż okno " << window << "x" << window << "." << std::endl;
+                return false;
+            }
+            int out_width = stats.width - window + 1;
+            if (!heatmap.empty() && !map.is_open()) {
+                map.open(heatmap, std::ios::binary);
+                if (!map.is_open()) {
+                    std::cerr << "Nie można zapisać mapy " << heatmap << std::endl;
+                    return false;
+                }
+                // Wysokość nieznana przed końcem obrazu: miejsce na nią jest rezerwowane i uzupełniane na końcu
+                map << "P5\n" << out_width << " ";
+                height_position = map.tellp();
+                map << "          \n255\n";
+            }
+
+            int out_rows = static_cast<int>(rows.size()) - window + 1;
+            if (out_rows <= 0) {
+                break;
+            }
+            out_rows = std::min(out_rows, band_rows);
+            scores.resize(static_cast<size_t>(out_rows) * out_width);
+            scoreBand(out_rows, out_width);
+
+            // Wyniki pasa: mapa i trafienia, wiersz po wierszu
+            for (int y = 0; y < out_rows; ++y) {
+                const float* row = &scores[static_cast<size_t>(y) * out_width];
+                for (int x = 0; x < out_width; ++x) {
+                    if (row[x] >= threshold) {
+                        hits << x << "," << first_row + y << "," << row[x] << "\n";
+                        ++stats.hits;
+                    }
+                }
+                if (map.is_open()) {
+                    pixels.resize(out_width);
+                    for (int x = 0; x < out_width; ++x) {
+                        pixels[x] = static_cast<unsigned char>(std::lround(row[x] * 255.0f));
+                    }
+                    map.write(reinterpret_cast<const char*>(pixels.data()), out_width);
+                }
+            }
+            stats.windows += static_cast<size_t>(out_rows) * out_width;
+
+            // Zostaje tylko zakładka potrzebna następnemu pasowi
+            rows.erase(rows.begin(), rows.begin() + out_rows);
+            first_row += out_rows;
+        }
+
+        if (map.is_open()) {
+            int out_height = std::max(0, stats.height - window + 1);
+            map.seekp(height_position);
+            std::string height_text = std::to_string(out_height);
+            map << height_text << std::string(10 - std::min<size_t>(10, height_text.size()), ' ');
+        }
+        hits.flush();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        stats.seconds = elapsed.count();
+        if (stats.height < window) {
+            std::cerr << "Obraz jest niższy niż okno " << window << "x" << window << "." << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    // Bufory jednego wątku: sumy warstwy ukrytej dla okien kafelka [tile_width x hidden]
+    struct TileBuffers {
+        AlignedBuffer<double> hidden;
+    };
+
+    int window;
+    int hidden_size;
+    int tile_width;
+    ThreadPool pool;
+    AlignedBuffer<double> pixel_weights;   // Wagi wejście->ukryta w układzie [piksel okna][neuron]
+    std::vector<double> output_weights;    // Wagi ukryta->wyjście
+    std::vector<TileBuffers> buffers;      // Osobne bufory dla każdego wątku
+    std::vector<std::vector<int>> rows;    // Wiersze pasa: posortowane kolumny zapalonych pikseli
+    std::vector<float> scores;             // Wyniki pasa [out_rows x out_width]
+    std::vector<unsigned char> pixels;     // Wiersz mapy PGM
+
+    // Dodaje wiersz obrazu do pasa (puste linie są pomijane); false, gdy wiersz ma inną szerokość niż pierwszy
+    bool parseRow(const std::string& line, ScanStats& stats) {
+        std::vector<int> lit;
+        int width = 0;
+        for (char pixel : line) {
+            if (pixel == '0' || pixel == '1') {
+                if (pixel == '1') {
+                    lit.push_back(width);
+                }
+                ++width;
+            }
+        }
+        if (width == 0) {
+            return true;
+        }
+        if (stats.height == 0) {
+            stats.width = width;
+        } else if (width != stats.width) {
+            std::cerr << "Wiersz " << stats.height << " ma " << width << " pikseli zamiast " << stats.width << "." << std::endl;
+            return false;
+        }
+        ++stats.height;
+        rows.push_back(std::move(lit));
+        return true;
+    }
+
+    // Liczy wyniki wszystkich okien pasa; kafelki kolumn rozdzielone między wątki
+    void scoreBand(int out_rows, int out_width) {
+        int tiles = (out_width + tile_width - 1) / tile_width;
+        int threads = pool.size();
+        pool.run([&](int id) {
+            for (int tile = id; tile < tiles; tile += threads) {
+                int x0 = tile * tile_width;
+                int x1 = std::min(out_width, x0 + tile_width);
+                for (int y = 0; y < out_rows; ++y) {
+                    scoreTile(buffers[id], y, x0, x1, &scores[static_cast<size_t>(y) * out_width]);
+                }
+            }
+        });
+    }
+
+    // Okna o lewym górnym rogu w wierszu y pasa i kolumnach [x0, x1)
+    void scoreTile(TileBuffers& buffer, int y, int x0, int x1, float* out) const {
+        const KernelTable<double>& kt = kernels<double>();
+        AlignedBuffer<double>& hidden = buffer.hidden;
+        hidden.assign(static_cast<size_t>(x1 - x0) * hidden_size, 0.0);
+
+        for (int r = 0; r < window; ++r) {
+            const std::vector<int>& lit = rows[y + r];
+            // Zapalone piksele, które trafiają do któregoś okna kafelka: kolumny [x0, x1 + window - 1)
+            auto it = std::lower_bound(lit.begin(), lit.end(), x0);
+            for (; it != lit.end() && *it < x1 + window - 1; ++it) {
+                int column = *it;
+                int c_begin = std::max(0, column - x1 + 1);
+                int c_end = std::min(window - 1, column - x0);
+                for (int c = c_begin; c <= c_end; ++c) {
+                    // Piksel (r, c) okna zaczynającego się w kolumnie column - c
+                    const double* w = &pixel_weights[static_cast<size_t>(r * window + c) * hidden_size];
+                    kt.axpy(1.0, w, &hidden[static_cast<size_t>(column - c - x0) * hidden_size], hidden_size);
+                }
+            }
+        }
+
+        for (int x = x0; x < x1; ++x) {
+            double* h = &hidden[static_cast<size_t>(x - x0) * hidden_size];
+            kt.relu(h, hidden_size);  // Aktywacja ReLU
+            double sum = kt.dot(h, output_weights.data(), hidden_size);
+            out[x] = static_cast<float>(1.0 / (1.0 + std::exp(-sum)));  // Aktywacja sigmoid
+        }
+    }
+};
+
+#endif
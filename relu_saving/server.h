@@ -0,0 +1,547 @@
+#ifndef XOCZY_SERVER_H
+#define XOCZY_SERVER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "dataset.h"
+#include "simple_nn.h"
+
+// Serwer wykrywania: model wczytany raz, obrazy przychodzą strumieniem (stdin albo gniazdo Unix),
+// a wynik każdego obrazu wysyłany jest od razu po policzeniu paczki.
+//
+// Protokół tekstowy, jedna ramka w jednej linii:
+//   żądanie:   "<id> <piksele>\n"   (piksele to input_size znaków '0'/'1', inne znaki pomijane)
+//   odpowiedź: "<id> <wynik>\n"     albo "<id> error <opis>\n"
+// Odpowiedzi mogą przyjść w innej kolejności niż żądania, dlatego klient dopasowuje je po id.
+// Ramka dłuższa niż maxFrameLength (id do MAX_REQUEST_ID znaków) zamyka połączenie.
+//
+// Mikropaczki: żądania czekają w kolejce, aż uzbiera się max_batch obrazów albo najstarsze
+// czeka już latency_budget; wtedy cała paczka liczona jest jednym forwardBatch.
+
+using ServerClock = std::chrono::steady_clock;
+
+// Połączenie, na które wracają odpowiedzi; deskryptor zamykany, gdy nikt już go nie używa
+class Connection {
+public:
+    Connection(int fd, bool owns_fd) : fd(fd), owns_fd(owns_fd) {}
+    ~Connection() {
+        if (owns_fd) {
+            ::close(fd);
+        }
+    }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    // Kończy odczyt: czekający read() wraca z końcem strumienia; odpowiedzi nadal można wysyłać
+    void stopReading() { ::shutdown(fd, SHUT_RD); }
+
+    // Zapisuje cały tekst; błąd zapisu (klient się rozłączył) tylko wyłącza dalsze zapisy
+    void send(const std::string& text) {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t sent = 0;
+        while (!broken && sent < text.size()) {
+            ssize_t n = ::write(fd, text.data() + sent, text.size() - sent);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                broken = true;
+            } else {
+                sent += n;
+            }
+        }
+    }
+
+private:
+    int fd;
+    bool owns_fd;
+    bool broken = false;
+    std::mutex mutex;
+};
+
+struct InferenceRequest {
+    std::string id;
+    std::vector<double> image;
+    std::shared_ptr<Connection> connection;
+    ServerClock::time_point arrived;
+};
+
+// Kolejka żądań liczona paczkami na jednym wątku (run); Net jak w BasicBatchDetector
+template <typename Net>
+class BasicMicroBatcher {
+public:
+    BasicMicroBatcher(Net& nn, int max_batch, std::chrono::microseconds latency_budget)
+        : nn(nn), max_batch(std::max(1, max_batch)), latency_budget(latency_budget),
+          inputs(static_cast<size_t>(this->max_batch) * nn.inputSize()),
+          outputs(static_cast<size_t>(this->max_batch) * nn.outputSize()),
+          closed(false), batches(0), requests(0) {}
+
+    void submit(InferenceRequest request) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(std::move(request));
+        }
+        ready.notify_one();
+    }
+
+    // Koniec żądań: run() liczy to, co zostało w kolejce, i wraca
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        ready.notify_one();
+    }
+
+    void run() {
+        std::vector<InferenceRequest> batch;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            ready.wait(lock, [this] { return closed || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            // Czekamy na pełną paczkę najwyżej do wyczerpania budżetu najstarszego żądania
+            ServerClock::time_point deadline = queue.front().arrived + latency_budget;
+            ready.wait_until(lock, deadline, [this] { return closed || queue.size() >= static_cast<size_t>(max_batch); });
+
+            size_t count = std::min(queue.size(), static_cast<size_t>(max_batch));
+            for (size_t i = 0; i < count; ++i) {
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+            lock.unlock();
+            score(batch);
+            batch.clear();  // Zwalnia połączenia, żeby zamknięte przez klienta mogły się zamknąć także tutaj
+            lock.lock();
+        }
+    }
+
+    size_t batchCount() const { return batches; }
+    size_t requestCount() const { return requests; }
+
+private:
+    Net& nn;
+    int max_batch;
+    std::chrono::microseconds latency_budget;
+    AlignedBuffer<double> inputs;   // Paczka obrazów [max_batch x input]
+    AlignedBuffer<double> outputs;  // Wyniki paczki [max_batch x output]
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<InferenceRequest> queue;
+    bool closed;
+    size_t batches;
+    size_t requests;
+
+    void score(std::vector<InferenceRequest>& batch) {
+        size_t input_size = nn.inputSize();
+        for (size_t i = 0; i < batch.size(); ++i) {
+            std::copy(batch[i].image.begin(), batch[i].image.end(), inputs.begin() + i * input_size);
+        }
+        nn.forwardBatch(inputs.data(), static_cast<int>(batch.size()), outputs.data());
+        ++batches;
+        requests += batch.size();
+
+        // Odpowiedzi kolejnych żądań z tego samego połączenia wysyłane jednym zapisem
+        std::string text;
+        char score_text[32];
+        for (size_t i = 0; i < batch.size(); ++i) {
+            std::snprintf(score_text, sizeof(score_text), " %.9g\n", outputs[i * nn.outputSize()]);
+            text += batch[i].id + score_text;
+            if (i + 1 == batch.size() || batch[i + 1].connection != batch[i].connection) {
+                batch[i].connection->send(text);
+                text.clear();
+            }
+        }
+    }
+};
+
+using MicroBatcher = BasicMicroBatcher<SimpleNN>;
+
+// Najdłuższy identyfikator żądania w znakach
+const size_t MAX_REQUEST_ID = 256;
+
+// Najdłuższa poprawna ramka: id, spacja, piksele (każdy może mieć jeden znak odstępu) i koniec linii
+inline size_t maxFrameLength(size_t image_size) { return MAX_REQUEST_ID + 2 * image_size + 4; }
+
+// Czyta ramki z deskryptora aż do końca strumienia i przekazuje je do kolejki.
+// Niezakończona ramka dłuższa niż maxFrameLength zamyka połączenie, żeby klient, który nigdy
+// nie wyśle '\n', nie zajął całej pamięci serwera.
+template <typename Net>
+void readFrames(int fd, const std::shared_ptr<Connection>& connection, BasicMicroBatcher<Net>& batcher, size_t image_size) {
+    size_t max_frame = maxFrameLength(image_size);
+    std::string pending;
+    char buffer[4096];
+    while (true) {
+        ssize_t n = ::read(fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        pending.append(buffer, n);
+
+        size_t start = 0;
+        size_t end;
+        while ((end = pending.find('\n', start)) != std::string::npos) {
+            size_t space = pending.find(' ', start);
+            if (space == std::string::npos || space > end) {
+                space = end;
+            }
+            InferenceRequest request;
+            request.id = pending.substr(start, space - start);
+            request.image.reserve(image_size);
+            for (size_t i = space; i < end; ++i) {
+                if (pending[i] == '0' || pending[i] == '1') {
+                    request.image.push_back(pending[i] - '0');
+                }
+            }
+            start = end + 1;
+            if (request.id.empty()) {
+                continue;  // Pusta linia
+            }
+            if (request.image.size() != image_size) {
+                connection->send(request.id + " error obraz ma " + std::to_string(request.image.size())
+                                 + " pikseli zamiast " + std::to_string(image_size) + "\n");
+                continue;
+            }
+            request.connection = connection;
+            request.arrived = ServerClock::now();
+            batcher.submit(std::move(request));
+        }
+        pending.erase(0, start);
+        if (pending.size() > max_frame) {
+            std::string id = pending.substr(0, std::min({pending.find(' '), pending.size(), MAX_REQUEST_ID}));
+            connection->send(id + " error ramka dłuższa niż " + std::to_string(max_frame) + " znaków, połączenie zamknięte\n");
+            return;
+        }
+    }
+}
+
+// Serwer na stdin/stdout: działa do końca strumienia wejściowego
+template <typename Net>
+void serveStdin(BasicMicroBatcher<Net>& batcher, size_t image_size) {
+    std::signal(SIGPIPE, SIG_IGN);
+    std::shared_ptr<Connection> out = std::make_shared<Connection>(STDOUT_FILENO, false);
+    std::thread reader([&] {
+        readFrames(STDIN_FILENO, out, batcher, image_size);
+        batcher.close();
+    });
+    batcher.run();
+    reader.join();
+}
+
+inline bool socketAddress(const std::string& path, sockaddr_un& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Za długa ścieżka gniazda " << path << std::endl;
+        return false;
+    }
+    std::strcpy(address.sun_path, path.c_str());
+    return true;
+}
+
+// Zapisywany przez obsługę SIGINT/SIGTERM, żeby poll() w pętli accept się obudził
+inline int server_stop_pipe = -1;
+
+inline void requestServerStop(int) {
+    char signal_byte = 1;
+    ssize_t written = ::write(server_stop_pipe, &signal_byte, 1);
+    (void)written;
+}
+
+// Wątek czytający jednego połączenia; połączenie trzymane do join, więc deskryptor nie wraca do systemu wcześniej
+struct SocketReader {
+    std::shared_ptr<Connection> connection;
+    std::thread thread;
+    std::atomic<bool> finished{false};
+};
+
+// Serwer na gnieździe Unix: każde połączenie ma własny wątek czytający, paczki liczone wspólnie.
+// Działa do SIGINT/SIGTERM: wtedy przestaje przyjmować połączenia, kończy odczyt wszystkich połączeń,
+// odsyła odpowiedzi na żądania z kolejki i czeka na wszystkie wątki. Zwraca false tylko wtedy,
+// gdy nie udało się uruchomić serwera albo accept zawiódł na stałe.
+template <typename Net>
+bool serveSocket(BasicMicroBatcher<Net>& batcher, const std::string& path, size_t image_size) {
+    std::signal(SIGPIPE, SIG_IGN);
+    sockaddr_un address;
+    if (!socketAddress(path, address)) {
+        return false;
+    }
+    int stop_pipe[2];
+    if (::pipe(stop_pipe) != 0) {
+        std::cerr << "Nie można utworzyć potoku zatrzymania: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(path.c_str());  // Gniazdo po poprzednim uruchomieniu
+    if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+        || ::listen(listener, 64) != 0) {
+        std::cerr << "Nie można nasłuchiwać na " << path << ": " << std::strerror(errno) << std::endl;
+        if (listener >= 0) {
+            ::close(listener);
+        }
+        ::close(stop_pipe[0]);
+        ::close(stop_pipe[1]);
+        return false;
+    }
+    server_stop_pipe = stop_pipe[1];
+    struct sigaction stop_action = {};
+    stop_action.sa_handler = requestServerStop;
+    sigemptyset(&stop_action.sa_mask);
+    struct sigaction old_interrupt;
+    struct sigaction old_terminate;
+    sigaction(SIGINT, &stop_action, &old_interrupt);
+    sigaction(SIGTERM, &stop_action, &old_terminate);
+    std::cerr << "Serwer nasłuchuje na " << path << std::endl;
+
+    std::thread worker([&] { batcher.run(); });
+    std::vector<std::unique_ptr<SocketReader>> readers;
+    bool failed = false;
+    while (true) {
+        pollfd events[2] = {{listener, POLLIN, 0}, {stop_pipe[0], POLLIN, 0}};
+        if (::poll(events, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Błąd poll: " << std::strerror(errno) << std::endl;
+            failed = true;
+            break;
+        }
+        if (events[1].revents != 0) {
+            break;
+        }
+        int fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN) {
+                continue;
+            }
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                // Brak deskryptorów albo pamięci mija, gdy inne połączenia się zamkną
+                std::cerr << "Błąd accept: " << std::strerror(errno) << std::endl;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                continue;
+            }
+            std::cerr << "Błąd accept: " << std::strerror(errno) << std::endl;
+            failed = true;
+            break;
+        }
+
+        // Wątki zakończonych połączeń dołączane przy kolejnym accept
+        for (std::unique_ptr<SocketReader>& reader : readers) {
+            if (reader->finished) {
+                reader->thread.join();
+                reader.reset();
+            }
+        }
+        readers.erase(std::remove(readers.begin(), readers.end(), nullptr), readers.end());
+
+        std::unique_ptr<SocketReader> reader = std::make_unique<SocketReader>();
+        reader->connection = std::make_shared<Connection>(fd, true);
+        SocketReader* slot = reader.get();
+        reader->thread = std::thread([fd, slot, &batcher, image_size] {
+            readFrames(fd, slot->connection, batcher, image_size);
+            slot->finished = true;
+        });
+        readers.push_back(std::move(reader));
+    }
+
+    ::close(listener);
+    ::unlink(path.c_str());
+    for (std::unique_ptr<SocketReader>& reader : readers) {
+        reader->connection->stopReading();
+    }
+    for (std::unique_ptr<SocketReader>& reader : readers) {
+        reader->thread.join();
+    }
+    readers.clear();
+    batcher.close();
+    worker.join();
+
+    sigaction(SIGINT, &old_interrupt, nullptr);
+    sigaction(SIGTERM, &old_terminate, nullptr);
+    server_stop_pipe = -1;
+    ::close(stop_pipe[0]);
+    ::close(stop_pipe[1]);
+    return !failed;
+}
+
+inline int connectSocket(const std::string& path) {
+    sockaddr_un address;
+    if (!socketAddress(path, address)) {
+        return -1;
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "Nie można połączyć z " << path << ": " << std::strerror(errno) << std::endl;
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+inline bool sendAll(int fd, const std::string& text) {
+    size_t sent = 0;
+    while (sent < text.size()) {
+        ssize_t n = ::write(fd, text.data() + sent, text.size() - sent);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+// Klient: obrazy ze stdin (pliki .txt połączone jeden za drugim) wysyłane jako ramki "numer piksele",
+// odpowiedzi serwera wypisywane na stdout
+inline bool runClient(const std::string& path, size_t image_size) {
+    int fd = connectSocket(path);
+    if (fd < 0) {
+        return false;
+    }
+    std::thread sender([fd, image_size] {
+        std::string frame;
+        size_t pixels = 0;
+        size_t index = 0;
+        char c;
+        while (std::cin.get(c)) {
+            if (c != '0' && c != '1') {
+                continue;
+            }
+            if (pixels == 0) {
+                frame = std::to_string(index) + " ";
+            }
+            frame += c;
+            if (++pixels == image_size) {
+                frame += "\n";
+                if (!sendAll(fd, frame)) {
+                    break;
+                }
+                pixels = 0;
+                ++index;
+            }
+        }
+        ::shutdown(fd, SHUT_WR);  // Koniec żądań; serwer odeśle pozostałe odpowiedzi
+    });
+
+    char buffer[4096];
+    ssize_t n;
+    while ((n = ::read(fd, buffer, sizeof(buffer))) > 0) {
+        std::cout.write(buffer, n);
+        std::cout.flush();  // Wyniki wypisywane od razu, gdy przyjdą
+    }
+    sender.join();
+    ::close(fd);
+    return true;
+}
+
+// Generator obciążenia: connections połączeń, każde wysyła kolejne żądanie po otrzymaniu odpowiedzi
+// na poprzednie. Mierzy przepustowość i rozkład opóźnień (od wysłania do odebrania odpowiedzi).
+inline bool runLoadGenerator(const std::string& path, size_t image_size, int total_requests, int connections) {
+    connections = std::max(1, connections);
+    std::vector<std::vector<double>> latencies(connections);  // Opóźnienia w mikrosekundach, osobno na wątek
+    std::vector<int> failures(connections, 0);
+
+    auto start = ServerClock::now();
+    std::vector<std::thread> clients;
+    for (int c = 0; c < connections; ++c) {
+        clients.emplace_back([&, c] {
+            int fd = connectSocket(path);
+            if (fd < 0) {
+                failures[c] = 1;
+                return;
+            }
+            unsigned seed = 12345u + c;
+            int count = total_requests / connections + (c < total_requests % connections ? 1 : 0);
+            std::string frame;
+            std::string reply;
+            char buffer[256];
+            for (int r = 0; r < count; ++r) {
+                frame = std::to_string(r) + " ";
+                for (size_t p = 0; p < image_size; ++p) {
+                    seed = seed * 1103515245u + 12345u;
+                    frame += ((seed >> 16) % 5 == 0) ? '1' : '0';  // Rzadki losowy obraz
+                }
+                frame += "\n";
+
+                auto sent = ServerClock::now();
+                if (!sendAll(fd, frame)) {
+                    failures[c] = 1;
+                    break;
+                }
+                reply.clear();
+                while (reply.find('\n') == std::string::npos) {
+                    ssize_t n = ::read(fd, buffer, sizeof(buffer));
+                    if (n <= 0) {
+                        failures[c] = 1;
+                        break;
+                    }
+                    reply.append(buffer, n);
+                }
+                if (failures[c]) {
+                    break;
+                }
+                std::chrono::duration<double, std::micro> latency = ServerClock::now() - sent;
+                latencies[c].push_back(latency.count());
+            }
+            ::close(fd);
+        });
+    }
+    for (std::thread& client : clients) {
+        client.join();
+    }
+    std::chrono::duration<double> elapsed = ServerClock::now() - start;
+
+    std::vector<double> all;
+    for (const std::vector<double>& part : latencies) {
+        all.insert(all.end(), part.begin(), part.end());
+    }
+    if (all.empty()) {
+        std::cerr << "Brak odpowiedzi serwera." << std::endl;
+        return false;
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p) { return all[std::min(all.size() - 1, static_cast<size_t>(p * all.size()))]; };
+
+    std::cout << "Żądania: " << all.size() << ", połączenia: " << connections << std::endl;
+    std::cout << "Przepustowość: " << all.size() / elapsed.count() << " obrazów/s" << std::endl;
+    std::cout << "Opóźnienie [us]: p50 " << percentile(0.50) << ", p90 " << percentile(0.90)
+              << ", p99 " << percentile(0.99) << ", maks. " << all.back() << std::endl;
+    int failed = 0;
+    for (int f : failures) {
+        failed += f;
+    }
+    if (failed > 0) {
+        std::cerr << "Połączenia zakończone błędem: " << failed << std::endl;
+    }
+    return failed == 0;
+}
+
+#endif
@@ -0,0 +1,421 @@
+#ifndef XOCZY_SIMPLE_NN_H
+#define XOCZY_SIMPLE_NN_H
+
+#include <cassert>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <limits>
+
+#include "bit_image.h"
+#include "dataset.h"
+#include "kernels.h"
+#include "optimizer.h"
+#include "random.h"
+#include "softmax.h"
+#include "telemetry.h"
+
+// Gradienty i bufory pośrednie dla jednej paczki próbek.
+// Każdy wątek uczący ma własną instancję, dzięki czemu nie dzieli buforów z innymi.
+template <typename T>
+struct BatchGradients {
+    AlignedBuffer<T> weights;       // Suma gradientów po paczce: [wejście->ukryta | ukryta->wyjście]
+    AlignedBuffer<T> hidden;        // Warstwa ukryta dla paczki [batch x hidden]
+    AlignedBuffer<T> output;        // Wyjścia, a potem błędy wyjścia dla paczki [batch x output]
+    AlignedBuffer<T> hidden_error;  // Błędy warstwy ukrytej dla paczki [batch x hidden]
+    int samples = 0;                // Liczba próbek zsumowanych w weights
+
+    void resize(size_t input_hidden, size_t hidden_output, size_t batch_hidden, size_t batch_output) {
+        weights.resize(input_hidden + hidden_output);
+        hidden.resize(batch_hidden);
+        output.resize(batch_output);
+        hidden_error.resize(batch_hidden);
+    }
+};
+
+// Prosta sieć neuronowa z jedną warstwą ukrytą oraz funkcjami aktywacji ReLU i Sigmoid (albo softmax na wyjściu klasyfikatora).
+// T to typ wag i aktywacji: double (domyślnie, SimpleNN) albo float (dwa razy więcej liczb w rejestrze SIMD, połowa pamięci).
+template <typename T>
+class BasicNN {
+public:
+    using Scalar = T;
+    using Gradients = BatchGradients<T>;
+
+    // Konstruktor inicjalizujący sieć neuronową; te same rozmiary i ziarno dają zawsze te same wagi
+    BasicNN(int input_size, int hidden_size, int output_size, uint64_t seed = DEFAULT_SEED) : input_size(input_size) {
+        // Inicjalizacja wektorów wag dla połączeń między warstwami
+        input_hidden_weights.resize(input_size * hidden_size);  // Wagi między warstwą wejściową a ukrytą
+        hidden_output_weights.resize(hidden_size * output_size); // Wagi między warstwą ukrytą a wyjściową
+        hidden_layer.resize(hidden_size);  // Warstwa ukryta (30 neuronów)
+        output_layer.resize(output_size);  // Warstwa wyjściowa (1 neuron)
+        hidden_error.resize(hidden_size);  // Bufory błędów dla train, przydzielane raz
+        output_error.resize(output_size);
+        active_inputs.resize(input_size);  // Bufor na indeksy zapalonych pikseli
+
+        // Inicjalizacja wag: He dla warstwy z ReLU, Xavier dla wyjścia z sigmoidem
+        initializeWeights(input_hidden_weights.data(), input_hidden_weights.size(), input_size, hidden_size, INIT_HE, seed, 0);
+        initializeWeights(hidden_output_weights.data(), hidden_output_weights.size(), hidden_size, output_size, INIT_XAVIER, seed, 1);
+    }
+
+    // Funkcja forward propagation (przepływ sygnału od wejścia do wyjścia).
+    // Zwraca referencję na warstwę wyjściową sieci (bez kopiowania), ważną do następnego wywołania.
+    const std::vector<T>& forward(const std::vector<T>& inputs) {
+        return forward(inputs.data());
+    }
+
+    // Forward propagation z wynikiem zapisanym do bufora wywołującego [output_size]
+    void forward(const T* inputs, T* outputs) {
+        const std::vector<T>& result = forward(inputs);
+        std::copy(result.begin(), result.end(), outputs);
+    }
+
+    // Forward propagation dla obrazu leżącego w ciągłym bloku pamięci (np. wiersz Dataset)
+    const std::vector<T>& forward(const T* inputs) {
+        const KernelTable<T>& kt = kernels<T>();
+        int hidden_size = hidden_layer.size();
+
+        // Obliczanie wartości neuronów w warstwie ukrytej
+        for (int i = 0; i < hidden_size; ++i) {
+            hidden_layer[i] = kt.dot(inputs, &input_hidden_weights[i * input_size], input_size);  // Suma ważona
+        }
+        kt.relu(hidden_layer.data(), hidden_size);  // Aktywacja ReLU
+
+        return computeOutput();
+    }
+
+    // Forward propagation dla obrazu binarnego spakowanego w bity.
+    // Wejścia to wyłącznie 0 lub 1, więc zamiast mnożyć przez każdy piksel
+    // sumujemy tylko wagi zapalonych pikseli (rzadkie pociągnięcia = kilkanaście sum zamiast 100).
+    // Obraz musi mieć inputSize() pikseli; piksele spoza sieci są pomijane, a nie zapisywane poza bufor.
+    const std::vector<T>& forward(const BitImage& inputs) {
+        assert(inputs.size() == active_inputs.size());
+        size_t active = inputs.setBits(active_inputs.data(), active_inputs.size());  // Indeksy zapalonych pikseli, liczone raz dla wszystkich neuronów
+
+        for (int i = 0; i < hidden_layer.size(); ++i) {
+            const T* row = &input_hidden_weights[i * input_size];  // Wagi i-tego neuronu ukrytego
+            T sum = 0;
+            for (size_t k = 0; k < active; ++k) {
+                sum += row[active_inputs[k]];
+            }
+            hidden_layer[i] = relu(sum);  // Aktywacja ReLU
+        }
+
+        return computeOutput();
+    }
+
+    // Funkcja uczenia sieci neuronowej (backpropagation)
+    void train(const std::vector<T>& inputs, const std::vector<T>& expected_output, T learning_rate) {
+        train(inputs.data(), expected_output.data(), learning_rate);
+    }
+
+    // Uczenie na próbce i etykiecie wskazanych bezpośrednio w pamięci (bez kopiowania i bez alokacji)
+    void train(const T* inputs, const T* expected_output, T learning_rate) {
+        TELEMETRY_PHASE("forward");
+        forward(inputs);  // Przeprowadza forward propagation na wejściu
+        TELEMETRY_NEXT_PHASE("backprop");
+
+        // Obliczanie błędów dla warstwy wyjściowej
+        for (int i = 0; i < output_layer.size(); ++i) {
+            output_error[i] = expected_output[i] - output_layer[i];  // Różnica między oczekiwanym a rzeczywistym wynikiem
+        }
+
+        // Obliczanie błędów dla warstwy ukrytej
+        for (int i = 0; i < hidden_layer.size(); ++i) {
+            hidden_error[i] = 0;
+            for (int j = 0; j < output_layer.size(); ++j) {
+                hidden_error[i] += output_error[j] * hidden_output_weights[j * hidden_layer.size() + i];  // Błąd sumowany dla każdego wyjścia
+            }
+            hidden_error[i] *= relu_derivative(hidden_layer[i]);  // Mnożenie przez pochodną ReLU
+        }
+
+        TELEMETRY_NEXT_PHASE("update");
+        const KernelTable<T>& kt = kernels<T>();
+        int hidden_size = hidden_layer.size();
+
+        // Aktualizacja wag między warstwą ukrytą a wyjściową (układ wag [wyjście][neuron ukryty]):
+        // do wiersza wag każdego wyjścia dodajemy warstwę ukrytą przeskalowaną przez błąd
+        for (int i = 0; i < output_layer.size(); ++i) {
+            kt.axpy(learning_rate * output_error[i], hidden_layer.data(), &hidden_output_weights[i * hidden_size], hidden_size);
+        }
+
+        // Aktualizacja wag między wejściem a warstwą ukrytą (układ wag [neuron ukryty][wejście], jak w forward)
+        for (int i = 0; i < hidden_size; ++i) {
+            if (hidden_error[i] != 0) {  // Martwy neuron ReLU nie zmienia swoich wag
+                kt.axpy(learning_rate * hidden_error[i], inputs, &input_hidden_weights[i * input_size], input_size);
+            }
+        }
+        zeroPruned(0, parameterCount());
+    }
+
+    // Forward propagation dla paczki obrazów: inputs to macierz [batch x input_size],
+    // outputs to macierz [batch x output_size]. Obie warstwy liczone jako mnożenie macierzy.
+    void forwardBatch(const T* inputs, int batch, T* outputs) {
+        forwardBatch(inputs, batch, outputs, batch_grad.hidden);
+    }
+
+    // Liczy sumę gradientów paczki do grad, nie zmieniając wag.
+    // Nie korzysta z buforów sieci, więc wiele wątków może liczyć gradienty jednocześnie,
+    // każdy z własnym BatchGradients.
+    void computeGradients(const T* inputs, const T* expected_output, int batch, BatchGradients<T>& grad) const {
+        int hidden_size = hidden_layer.size();
+        int output_size = output_layer.size();
+        grad.resize(input_hidden_weights.size(), hidden_output_weights.size(), batch * hidden_size, batch * output_size);
+        std::fill(grad.weights.begin(), grad.weights.end(), T(0));
+        grad.samples = batch;
+        if (batch == 0) {
+            return;
+        }
+
+        TELEMETRY_PHASE("forward");
+        forwardBatch(inputs, batch, grad.output.data(), grad.hidden);
+        TELEMETRY_NEXT_PHASE("backprop");
+
+        // Błędy warstwy wyjściowej (nadpisują wyniki, które nie są już potrzebne)
+        for (int i = 0; i < batch * output_size; ++i) {
+            grad.output[i] = expected_output[i] - grad.output[i];
+        }
+
+        // Błędy warstwy ukrytej: [batch x output] * [output x hidden], razy pochodna ReLU
+        gemmNN(grad.output.data(), hidden_output_weights.data(), grad.hidden_error.data(), batch, hidden_size, output_size);
+        for (int i = 0; i < batch * hidden_size; ++i) {
+            grad.hidden_error[i] *= relu_derivative(grad.hidden[i]);
+        }
+
+        // Suma gradientów z całej paczki, w tym samym układzie co wagi: [wejście->ukryta | ukryta->wyjście]
+        T* input_hidden_grad = grad.weights.data();
+        T* hidden_output_grad = input_hidden_grad + input_hidden_weights.size();
+        gemmTN(grad.hidden_error.data(), inputs, input_hidden_grad, hidden_size, input_size, batch, T(1));
+        gemmTN(grad.output.data(), grad.hidden.data(), hidden_output_grad, output_size, hidden_size, batch, T(1));
+    }
+
+    // Zmienia wagi o średni gradient z count buforów (suma dzielona przez liczbę wszystkich próbek),
+    // tylko dla parametrów [begin, end). Indeksy parametrów: najpierw wagi wejście->ukryta, potem ukryta->wyjście.
+    // Rozłączne zakresy mogą być aktualizowane równolegle przez różne wątki.
+    void applyGradients(const BatchGradients<T>* const* grads, int count, T learning_rate, size_t begin, size_t end) {
+        TELEMETRY_SCOPE("update");
+        T scale = averageScale<T>(grads, count);
+        if (scale == 0) {
+            return;
+        }
+        size_t split = input_hidden_weights.size();
+        for (size_t i = begin; i < end; ++i) {
+            T sum = 0;
+            for (int g = 0; g < count; ++g) {
+                sum += grads[g]->weights[i];
+            }
+            sum *= scale;
+            if (i < split) {
+                input_hidden_weights[i] += optimizer.delta(i, sum, learning_rate);
+            } else {
+                hidden_output_weights[i - split] += optimizer.delta(i, sum, learning_rate);
+            }
+        }
+        zeroPruned(begin, end);
+    }
+
+    // Przycięte wagi (indeksy jak w applyGradients): zerowane od razu i po każdej zmianie wag,
+    // więc dostrajanie po przycięciu uczy tylko pozostawione wagi
+    void setPrunedWeights(std::vector<size_t> indices) {
+        std::sort(indices.begin(), indices.end());
+        pruned_weights = std::move(indices);
+        zeroPruned(0, parameterCount());
+    }
+
+    const std::vector<size_t>& prunedWeights() const { return pruned_weights; }
+
+    // Optymalizator dla applyGradients (a więc trainBatch i ParallelTrainer); train na pojedynczej
+    // próbce zawsze zmienia wagi zwykłym SGD
+    void setOptimizer(const OptimizerSettings& settings) { optimizer.configure(settings, parameterCount()); }
+    OptimizerType optimizerType() const { return optimizer.type(); }
+
+    // Początek kroku uczenia: raz przed applyGradients dla wszystkich zakresów parametrów
+    void beginStep() { optimizer.beginStep(); }
+
+    // Uczenie na paczce próbek: inputs [batch x input_size], expected_output [batch x output_size].
+    // Gradienty całej paczki są uśredniane i wagi zmieniane raz na paczkę,
+    // więc macierz wag czytana jest raz na paczkę, a nie raz na próbkę.
+    void trainBatch(const T* inputs, const T* expected_output, int batch, T learning_rate) {
+        computeGradients(inputs, expected_output, batch, batch_grad);
+        beginStep();
+        const BatchGradients<T>* grads[] = {&batch_grad};
+        applyGradients(grads, 1, learning_rate, 0, parameterCount());
+    }
+
+    // Liczba wszystkich wag sieci
+    size_t parameterCount() const { return input_hidden_weights.size() + hidden_output_weights.size(); }
+
+    int inputSize() const { return input_size; }
+    int hiddenSize() const { return hidden_layer.size(); }
+    int outputSize() const { return output_layer.size(); }
+
+    // Wagi tylko do odczytu, np. do kwantyzacji albo zapisu w innym formacie
+    const std::vector<T>& inputHiddenWeights() const { return input_hidden_weights; }
+    const std::vector<T>& hiddenOutputWeights() const { return hidden_output_weights; }
+
+    // Funkcja zapisująca wagi do pliku (z pełną precyzją, żeby odczyt dał dokładnie te same liczby)
+    void saveWeights(const std::string& filename) {
+        TELEMETRY_SCOPE("save_weights");
+        std::ofstream file(filename);
+        if (file.is_open()) {
+            file.precision(std::numeric_limits<T>::max_digits10);
+            for (const T& weight : input_hidden_weights) {
+                file << weight << "\n";  // Zapis wag między wejściem a ukrytą warstwą
+            }
+            for (const T& weight : hidden_output_weights) {
+                file << weight << "\n";  // Zapis wag między ukrytą a wyjściową warstwą
+            }
+            file.close();
+        } else {
+            std::cerr << "Could not open file for writing." << std::endl;
+        }
+    }
+
+    // Funkcja wczytująca wagi z pliku; zwraca false, gdy liczba wag w pliku nie zgadza się z rozmiarem sieci.
+    // Wagi czytane są do osobnych buforów, więc przy błędzie sieć zachowuje poprzednie wagi.
+    bool loadWeights(const std::string& filename) {
+        std::ifstream file(filename);
+        if (file.is_open()) {
+            std::vector<T> input_hidden(input_hidden_weights.size());
+            std::vector<T> hidden_output(hidden_output_weights.size());
+            for (T& weight : input_hidden) {
+                file >> weight;  // Wczytywanie wag między wejściem a warstwą ukrytą
+            }
+            for (T& weight : hidden_output) {
+                file >> weight;  // Wczytywanie wag między ukrytą a wyjściową warstwą
+            }
+            T extra;
+            bool ok = !file.fail() && !(file >> extra);  // Wszystkie wagi wczytane i nic nie zostało
+            file.close();
+            if (!ok) {
+                std::cerr << "Plik " << filename << " nie zawiera " << parameterCount() << " wag." << std::endl;
+                return false;
+            }
+            input_hidden_weights.swap(input_hidden);
+            hidden_output_weights.swap(hidden_output);
+            return true;
+        } else {
+            std::cerr << "Could not open file for reading." << std::endl;
+            return false;
+        }
+    }
+
+    // Softmax na wyjściu zamienia sieć w klasyfikator outputSize() klas.
+    // Uczenie się nie zmienia: softmax z entropią krzyżową ma ten sam błąd wyjścia co sigmoid.
+    void setOutputActivation(OutputActivation activation) { output_activation = activation; }
+    OutputActivation outputActivation() const { return output_activation; }
+
+    // k najbardziej prawdopodobnych klas obrazu (k <= outputSize()); jedna warstwa ukryta dla wszystkich klas
+    void topK(const T* inputs, int k, ClassScore* top) {
+        forward(inputs);
+        selectTopK(output_layer.data(), outputSize(), k, top);
+    }
+
+    // k najlepszych klas dla każdego obrazu paczki [batch x input_size]; wynik [batch x k]
+    void topKBatch(const T* inputs, int batch, int k, ClassScore* top) {
+        int classes = outputSize();
+        class_scores.resize(static_cast<size_t>(batch) * classes);
+        forwardBatch(inputs, batch, class_scores.data());
+        for (int b = 0; b < batch; ++b) {
+            selectTopK(&class_scores[static_cast<size_t>(b) * classes], classes, k, top + static_cast<size_t>(b) * k);
+        }
+    }
+
+    // Ustawia wszystkie wagi z zewnętrznych bloków (np. zmapowanego pliku modelu)
+    template <typename U>
+    void setWeights(const U* input_hidden, const U* hidden_output) {
+        input_hidden_weights.assign(input_hidden, input_hidden + input_hidden_weights.size());
+        hidden_output_weights.assign(hidden_output, hidden_output + hidden_output_weights.size());
+    }
+
+private:
+    int input_size;  // Liczba wejść (pikseli obrazu)
+    std::vector<T> input_hidden_weights;  // Wagi między warstwą wejściową a ukrytą
+    std::vector<T> hidden_output_weights;  // Wagi między warstwą ukrytą a wyjściową
+    std::vector<T> hidden_layer;  // Neurony w warstwie ukrytej
+    std::vector<T> output_layer;  // Neurony w warstwie wyjściowej
+    std::vector<T> hidden_error;  // Błędy warstwy ukrytej w train
+    std::vector<T> output_error;  // Błędy warstwy wyjściowej w train
+    std::vector<int> active_inputs;  // Indeksy zapalonych pikseli dla wejścia binarnego
+    OutputActivation output_activation = OUTPUT_SIGMOID;
+    BatchGradients<T> batch_grad;  // Bufory dla trainBatch/forwardBatch wywoływanych na samej sieci
+    Optimizer<T> optimizer;        // Stan momentum/Adam dla applyGradients
+    AlignedBuffer<T> class_scores; // Wyniki wszystkich klas paczki w topKBatch
+    std::vector<size_t> pruned_weights;  // Posortowane indeksy przyciętych wag (puste bez przycinania)
+
+    // Zeruje przycięte wagi o indeksach z [begin, end)
+    void zeroPruned(size_t begin, size_t end) {
+        size_t split = input_hidden_weights.size();
+        for (auto it = std::lower_bound(pruned_weights.begin(), pruned_weights.end(), begin); it != pruned_weights.end() && *it < end; ++it) {
+            if (*it < split) {
+                input_hidden_weights[*it] = 0;
+            } else {
+                hidden_output_weights[*it - split] = 0;
+            }
+        }
+    }
+
+    // Forward propagation paczki z warstwą ukrytą zapisywaną do podanego bufora
+    void forwardBatch(const T* inputs, int batch, T* outputs, AlignedBuffer<T>& hidden) const {
+        int hidden_size = hidden_layer.size();
+        int output_size = output_layer.size();
+        hidden.resize(batch * hidden_size);
+
+        gemmNT(inputs, input_hidden_weights.data(), hidden.data(), batch, hidden_size, input_size);
+        kernels<T>().relu(hidden.data(), batch * hidden_size);  // Aktywacja ReLU
+        gemmNT(hidden.data(), hidden_output_weights.data(), outputs, batch, output_size, hidden_size);
+        activateOutputs(outputs, batch);
+    }
+
+    // Oblicza warstwę wyjściową na podstawie już policzonej warstwy ukrytej
+    const std::vector<T>& computeOutput() {
+        const KernelTable<T>& kt = kernels<T>();
+        int hidden_size = hidden_layer.size();
+        for (int i = 0; i < output_layer.size(); ++i) {
+            output_layer[i] = kt.dot(hidden_layer.data(), &hidden_output_weights[i * hidden_size], hidden_size);  // Suma ważona
+        }
+        activateOutputs(output_layer.data(), 1);
+
+        return output_layer;  // Zwraca wartości neuronów w warstwie wyjściowej
+    }
+
+    // Aktywacja wyjścia dla count wierszy: sigmoid każdego wyjścia albo softmax całego wiersza
+    void activateOutputs(T* outputs, int count) const {
+        int output_size = output_layer.size();
+        if (output_activation == OUTPUT_SOFTMAX) {
+            softmaxRows(outputs, count, output_size);
+        } else {
+            for (int i = 0; i < count * output_size; ++i) {
+                outputs[i] = sigmoid(outputs[i]);  // Aktywacja sigmoid
+            }
+        }
+    }
+
+    // Funkcja aktywacji sigmoid
+    static T sigmoid(T x) {
+        return T(1) / (T(1) + std::exp(-x));
+    }
+
+    // Pochodna funkcji sigmoid (używana w backpropagation)
+    static T sigmoid_derivative(T x) {
+        return x * (T(1) - x);
+    }
+
+    // Funkcja aktywacji ReLU
+    static T relu(T x) {
+        return x > 0 ? x : 0;
+    }
+
+    // Pochodna funkcji ReLU (używana w backpropagation)
+    static T relu_derivative(T x) {
+        return x > 0 ? 1 : 0;
+    }
+};
+
+// Sieć w podwójnej precyzji, jak w pozostałych wariantach programu
+using SimpleNN = BasicNN<double>;
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef XOCZY_SOFTMAX_H
+#define XOCZY_SOFTMAX_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Wyjście wieloklasowe: jedna sieć z K wyjściami zamiast K osobnych detektorów.
+// Softmax zamienia sumy wyjść na prawdopodobieństwa klas (dodatnie, sumujące się do 1).
+// W połączeniu z entropią krzyżową błąd wyjścia to po prostu (oczekiwane - wynik),
+// tak samo jak dla sigmoidu, więc propagacja wsteczna sieci się nie zmienia.
+
+// Funkcja aktywacji warstwy wyjściowej
+enum OutputActivation {
+    OUTPUT_SIGMOID,  // Każde wyjście osobno: detektor (jedno wyjście) albo wiele niezależnych etykiet
+    OUTPUT_SOFTMAX,  // Wyjścia to wzajemnie wykluczające się klasy
+};
+
+// Klasa i jej prawdopodobieństwo
+struct ClassScore {
+    int label;
+    double score;
+};
+
+// Softmax w miejscu na count wierszach po width wartości.
+// Od każdego wiersza odejmowane jest jego maksimum, żeby exp nie przekroczył zakresu.
+template <typename T>
+void softmaxRows(T* values, int count, int width) {
+    for (int r = 0; r < count; ++r) {
+        T* row = values + static_cast<size_t>(r) * width;
+        T max = *std::max_element(row, row + width);
+        T sum = 0;
+        for (int i = 0; i < width; ++i) {
+            row[i] = std::exp(row[i] - max);
+            sum += row[i];
+        }
+        for (int i = 0; i < width; ++i) {
+            row[i] /= sum;
+        }
+    }
+}
+
+// k klas o największym wyniku, od najlepszej (przy równych wynikach niższy numer klasy pierwszy)
+template <typename T>
+void selectTopK(const T* scores, int classes, int k, ClassScore* top) {
+    k = std::min(k, classes);
+    int filled = 0;
+    for (int c = 0; c < classes; ++c) {
+        // Wstawianie do krótkiej posortowanej listy: k jest małe, więc to szybsze niż sortowanie wszystkich klas
+        int position = filled;
+        while (position > 0 && top[position - 1].score < scores[c]) {
+            --position;
+        }
+        if (position >= k) {
+            continue;
+        }
+        for (int i = std::min(filled, k - 1); i > position; --i) {
+            top[i] = top[i - 1];
+        }
+        top[position] = {c, static_cast<double>(scores[c])};
+        filled = std::min(filled + 1, k);
+    }
+}
+
+#endif
@@ -0,0 +1,483 @@
+#ifndef XOCZY_SPARSE_H
+#define XOCZY_SPARSE_H
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "bit_image.h"
+#include "dataset.h"
+#include "model_file.h"
+#include "simple_nn.h"
+#include "softmax.h"
+
+// Przycinanie wytrenowanej sieci i wykrywanie na rzadkich wagach.
+//
+// Przycinanie według wartości bezwzględnej zeruje ułamek sparsity najmniejszych wag wejście->ukryta.
+// Potem usuwane są martwe neurony ukryte: bez żadnej dodatniej wagi wejściowej (obrazy są binarne,
+// więc ich suma nigdy nie przekroczy zera - dla każdego możliwego obrazu). Na życzenie (prune_idle)
+// usuwane są też neurony, które nie zapalają się dla żadnego obrazu zbioru treningowego - to już
+// przybliżenie, bo inny obraz mógłby je zapalić. Martwy neuron traci wszystkie wagi, także wyjściowe.
+// Przycięte wagi zostają zerami przy dostrajaniu (BasicNN::setPrunedWeights).
+//
+// SparseNN przechowuje tylko żywe neurony. Wagi wejście->ukryta ułożone są wierszami według wejść (CSR),
+// a w wierszu blokami po SPARSE_BLOCK sąsiednich neuronów (z pominięciem bloków samych zer)
+// albo pojedynczo, gdy w niezerowych blokach mniej niż połowa wag jest niezerowa (układ wybierany
+// raz dla całego modelu). Forward przechodzi tylko po niezerowych pikselach obrazu i niezerowych wagach
+// (blokach) ich wierszy, więc koszt zależy od liczby zapalonych pikseli i pozostawionych wag,
+// a nie od pełnego rozmiaru sieci.
+
+const int SPARSE_BLOCK = 8;  // Jeden rejestr AVX-512 liczb double albo AVX2 liczb float
+
+struct PruneReport {
+    size_t magnitude_pruned = 0;  // Wagi wejście->ukryta wyzerowane według wartości
+    int dead_neurons = 0;         // Neurony bez dodatniej wagi wejściowej
+    int idle_neurons = 0;         // Neurony nieaktywne na całym zbiorze treningowym (tylko z prune_idle)
+    size_t kept_weights = 0;      // Niezerowe wagi po przycięciu (obie warstwy)
+};
+
+// Przycina sieć: ułamek sparsity najmniejszych wag wejście->ukryta i martwe neurony;
+// z prune_idle także neurony nieaktywne na zbiorze data (zbiór treningowy)
+template <typename T>
+PruneReport pruneNetwork(BasicNN<T>& nn, double sparsity, const BasicDataset<T>& data, bool prune_idle = false) {
+    TELEMETRY_SCOPE("prune");
+    int input_size = nn.inputSize();
+    int hidden_size = nn.hiddenSize();
+    int output_size = nn.outputSize();
+    std::vector<T> w1 = nn.inputHiddenWeights();
+    const std::vector<T>& w2 = nn.hiddenOutputWeights();
+    std::vector<bool> pruned(nn.parameterCount(), false);
+    PruneReport report;
+
+    // Najmniejsze co do wartości bezwzględnej (przy równych wartościach - wcześniejszy indeks)
+    std::vector<size_t> order(w1.size());
+    std::iota(order.begin(), order.end(), 0);
+    size_t count = std::min(w1.size(), static_cast<size_t>(sparsity * w1.size() + 0.5));
+    std::nth_element(order.begin(), order.begin() + count, order.end(), [&](size_t a, size_t b) {
+        return std::abs(w1[a]) < std::abs(w1[b]) || (std::abs(w1[a]) == std::abs(w1[b]) && a < b);
+    });
+    for (size_t k = 0; k < count; ++k) {
+        pruned[order[k]] = true;
+        w1[order[k]] = 0;
+    }
+    report.magnitude_pruned = count;
+
+    // Neurony, które po przycięciu mogą się zapalić (i z prune_idle zapalają się choć raz na zbiorze treningowym)
+    std::vector<bool> dead(hidden_size, false);
+    for (int h = 0; h < hidden_size; ++h) {
+        const T* row = &w1[static_cast<size_t>(h) * input_size];
+        if (std::none_of(row, row + input_size, [](T w) { return w > 0; })) {
+            dead[h] = true;
+            ++report.dead_neurons;
+            continue;
+        }
+        if (!prune_idle) {
+            continue;
+        }
+        bool active = false;
+        for (size_t s = 0; s < data.size() && !active; ++s) {
+            active = kernels<T>().dot(data.sample(s), row, input_size) > 0;
+        }
+        if (!active) {
+            dead[h] = true;
+            ++report.idle_neurons;
+        }
+    }
+
+    size_t split = w1.size();
+    for (int h = 0; h < hidden_size; ++h) {
+        if (!dead[h]) {
+            continue;
+        }
+        std::fill(pruned.begin() + static_cast<size_t>(h) * input_size, pruned.begin() + static_cast<size_t>(h + 1) * input_size, true);
+        for (int o = 0; o < output_size; ++o) {
+            pruned[split + static_cast<size_t>(o) * hidden_size + h] = true;
+        }
+    }
+
+    std::vector<size_t> indices;
+    for (size_t i = 0; i < pruned.size(); ++i) {
+        if (pruned[i]) {
+            indices.push_back(i);
+        } else if ((i < split ? w1[i] : w2[i - split]) != 0) {
+            ++report.kept_weights;
+        }
+    }
+    nn.setPrunedWeights(std::move(indices));
+    return report;
+}
+
+// Nagłówek pliku model.sparse. Za nim, każda od granicy 64 bajtów, sekcje:
+// numery żywych neuronów [live_hidden] (uint32), początki wierszy [input_size + 1] (uint32),
+// numery bloków neuronów [blocks] (uint32), wagi bloków [blocks x block] i wagi wyjścia
+// [output_size x żywe neurony dopełnione do bloku] (typ dtype).
+struct SparseHeader {
+    char magic[4];               // "XOSP"
+    uint32_t version;            // SPARSE_VERSION
+    uint32_t input_size;
+    uint32_t hidden_size;        // Neurony ukryte pełnej sieci
+    uint32_t live_hidden;        // Neurony pozostawione w sieci rzadkiej
+    uint32_t output_size;
+    uint32_t dtype;              // ModelDType
+    uint32_t output_activation;  // ModelActivation warstwy wyjściowej
+    uint32_t block;              // Liczba neuronów w bloku
+    uint32_t blocks;             // Liczba niezerowych bloków
+    uint64_t file_size;
+    uint64_t checksum;           // FNV-1a 64 wszystkich bajtów za nagłówkiem
+    uint64_t reserved;
+};
+static_assert(sizeof(SparseHeader) == 64, "Nagłówek modelu rzadkiego musi mieć 64 bajty");
+
+const char SPARSE_MAGIC[4] = {'X', 'O', 'S', 'P'};
+const uint32_t SPARSE_VERSION = 1;
+
+// Sieć z wagami w postaci rzadkiej, tylko do wykrywania
+template <typename T>
+class SparseNN {
+public:
+    SparseNN() {}
+
+    // Buduje postać rzadką z (przyciętej) sieci gęstej; wynik forward jest taki sam jak sieci gęstej
+    explicit SparseNN(const BasicNN<T>& nn)
+        : input_size(nn.inputSize()), hidden_size(nn.hiddenSize()), output_size(nn.outputSize()),
+          output_activation(nn.outputActivation()) {
+        const std::vector<T>& w1 = nn.inputHiddenWeights();
+        const std::vector<T>& w2 = nn.hiddenOutputWeights();
+        // Żywy neuron: może się zapalić (ma dodatnią wagę wejściową) i wpływa na któreś wyjście
+        for (int h = 0; h < hidden_size; ++h) {
+            const T* row = &w1[static_cast<size_t>(h) * input_size];
+            bool fires = std::any_of(row, row + input_size, [](T w) { return w > 0; });
+            bool used = false;
+            for (int o = 0; o < output_size; ++o) {
+                used = used || w2[static_cast<size_t>(o) * hidden_size + h] != 0;
+            }
+            if (fires && used) {
+                neuron_ids.push_back(h);
+            }
+        }
+        // Bloki opłacają się, gdy co najmniej połowa ich wag jest niezerowa
+        size_t nonzero = 0;
+        size_t filled_blocks = 0;
+        for (int i = 0; i < input_size; ++i) {
+            for (size_t first = 0; first < neuron_ids.size(); first += SPARSE_BLOCK) {
+                size_t in_block = 0;
+                for (size_t live = first; live < std::min(first + SPARSE_BLOCK, neuron_ids.size()); ++live) {
+                    in_block += w1[static_cast<size_t>(neuron_ids[live]) * input_size + i] != 0;
+                }
+                nonzero += in_block;
+                filled_blocks += in_block > 0;
+            }
+        }
+        block = 2 * nonzero >= filled_blocks * SPARSE_BLOCK ? SPARSE_BLOCK : 1;
+        int padded = paddedHidden();
+
+        row_start.push_back(0);
+        for (int i = 0; i < input_size; ++i) {
+            for (int b = 0; b < padded / block; ++b) {
+                T weights[SPARSE_BLOCK];
+                bool any = false;
+                for (int k = 0; k < block; ++k) {
+                    size_t live = static_cast<size_t>(b) * block + k;
+                    weights[k] = live < neuron_ids.size() ? w1[static_cast<size_t>(neuron_ids[live]) * input_size + i] : T(0);
+                    any = any || weights[k] != 0;
+                }
+                if (any) {
+                    block_column.push_back(b);
+                    block_weights.insert(block_weights.end(), weights, weights + block);
+                }
+            }
+            row_start.push_back(block_column.size());
+        }
+
+        output_weights.assign(static_cast<size_t>(output_size) * padded, T(0));
+        for (int o = 0; o < output_size; ++o) {
+            for (size_t live = 0; live < neuron_ids.size(); ++live) {
+                output_weights[static_cast<size_t>(o) * padded + live] = w2[static_cast<size_t>(o) * hidden_size + neuron_ids[live]];
+            }
+        }
+        allocateBuffers();
+    }
+
+    // Forward dla obrazu w ciągłym bloku pamięci: tylko niezerowe piksele i niezerowe bloki ich wierszy
+    const std::vector<T>& forward(const T* inputs) {
+        std::fill(hidden.begin(), hidden.end(), T(0));
+        if (block == SPARSE_BLOCK) {
+            accumulate<SPARSE_BLOCK>(inputs);
+        } else {
+            accumulate<1>(inputs);
+        }
+        return computeOutput();
+    }
+
+    const std::vector<T>& forward(const std::vector<T>& inputs) { return forward(inputs.data()); }
+
+    // Forward dla obrazu spakowanego w bity: same dodawania wag zapalonych pikseli.
+    // Obraz musi mieć inputSize() pikseli; nadmiarowe piksele są pomijane.
+    const std::vector<T>& forward(const BitImage& inputs) {
+        assert(inputs.size() == static_cast<size_t>(input_size));
+        size_t active = inputs.setBits(active_inputs.data(), input_size);
+        std::fill(hidden.begin(), hidden.end(), T(0));
+        if (block == SPARSE_BLOCK) {
+            accumulateBits<SPARSE_BLOCK>(active);
+        } else {
+            accumulateBits<1>(active);
+        }
+        return computeOutput();
+    }
+
+    int inputSize() const { return input_size; }
+    int outputSize() const { return output_size; }
+    int hiddenSize() const { return hidden_size; }
+    int liveHidden() const { return static_cast<int>(neuron_ids.size()); }
+    size_t blockCount() const { return block_column.size(); }
+    int blockSize() const { return block; }
+    OutputActivation outputActivation() const { return output_activation; }
+
+    // Bajty wag i indeksów potrzebne do forward
+    size_t weightBytes() const {
+        return (block_weights.size() + output_weights.size()) * sizeof(T) + (row_start.size() + block_column.size()) * sizeof(uint32_t);
+    }
+
+    bool save(const std::string& filename) const {
+        TELEMETRY_SCOPE("save_model");
+        SparseHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, SPARSE_MAGIC, sizeof(SPARSE_MAGIC));
+        header.version = SPARSE_VERSION;
+        header.input_size = input_size;
+        header.hidden_size = hidden_size;
+        header.live_hidden = neuron_ids.size();
+        header.output_size = output_size;
+        header.dtype = modelDType<T>();
+        header.output_activation = output_activation == OUTPUT_SOFTMAX ? ACTIVATION_SOFTMAX : ACTIVATION_SIGMOID;
+        header.block = block;
+        header.blocks = block_column.size();
+
+        std::vector<unsigned char> body;
+        appendSection(body, neuron_ids.data(), neuron_ids.size());
+        appendSection(body, row_start.data(), row_start.size());
+        appendSection(body, block_column.data(), block_column.size());
+        appendSection(body, block_weights.data(), block_weights.size());
+        appendSection(body, output_weights.data(), output_weights.size());
+        header.file_size = sizeof(SparseHeader) + body.size();
+        header.checksum = modelChecksum(body.data(), body.size());
+
+        std::ofstream file(filename, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Nie można zapisać modelu " << filename << std::endl;
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(body.data()), body.size());
+        return file.good();
+    }
+
+    // Wczytuje model.sparse; wagi zapisane jako float albo double są zamieniane na T
+    bool load(const std::string& filename) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Nie można otworzyć modelu " << filename << std::endl;
+            return false;
+        }
+        std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        SparseHeader header;
+        if (bytes.size() < sizeof(header)) {
+            std::cerr << "Plik " << filename << " nie jest modelem rzadkim." << std::endl;
+            return false;
+        }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        const unsigned char* body = bytes.data() + sizeof(header);
+        size_t body_size = bytes.size() - sizeof(header);
+        if (std::memcmp(header.magic, SPARSE_MAGIC, sizeof(SPARSE_MAGIC)) != 0 || header.version != SPARSE_VERSION
+            || (header.block != SPARSE_BLOCK && header.block != 1) || header.file_size != bytes.size()
+            || (header.dtype != DTYPE_FLOAT64 && header.dtype != DTYPE_FLOAT32)
+            || header.live_hidden > header.hidden_size || modelChecksum(body, body_size) != header.checksum) {
+            std::cerr << "Plik " << filename << " nie jest poprawnym modelem rzadkim." << std::endl;
+            return false;
+        }
+
+        input_size = header.input_size;
+        hidden_size = header.hidden_size;
+        output_size = header.output_size;
+        output_activation = header.output_activation == ACTIVATION_SOFTMAX ? OUTPUT_SOFTMAX : OUTPUT_SIGMOID;
+        block = header.block;
+        size_t padded = (header.live_hidden + SPARSE_BLOCK - 1) / SPARSE_BLOCK * SPARSE_BLOCK;
+        size_t offset = 0;
+        bool ok = readSection(body, body_size, offset, neuron_ids, header.live_hidden)
+                  && readSection(body, body_size, offset, row_start, static_cast<size_t>(input_size) + 1)
+                  && readSection(body, body_size, offset, block_column, header.blocks)
+                  && readWeights(body, body_size, offset, header.dtype, block_weights, static_cast<size_t>(header.blocks) * block)
+                  && readWeights(body, body_size, offset, header.dtype, output_weights, output_size * padded);
+        // Indeksy muszą wskazywać wewnątrz tablic, żeby forward nie wyszedł poza bufory
+        ok = ok && row_start.front() == 0 && row_start.back() == header.blocks && std::is_sorted(row_start.begin(), row_start.end())
+             && std::all_of(block_column.begin(), block_column.end(), [&](uint32_t b) { return b < padded / block; });
+        if (!ok) {
+            std::cerr << "Plik " << filename << " ma uszkodzone sekcje." << std::endl;
+            return false;
+        }
+        allocateBuffers();
+        return true;
+    }
+
+private:
+    int input_size = 0;
+    int hidden_size = 0;
+    int output_size = 0;
+    OutputActivation output_activation = OUTPUT_SIGMOID;
+    int block = SPARSE_BLOCK;            // Neurony w bloku: SPARSE_BLOCK albo 1 (zwykły CSR)
+    std::vector<uint32_t> neuron_ids;    // Numer każdego żywego neuronu w pełnej sieci
+    std::vector<uint32_t> row_start;     // Pierwszy blok wiersza każdego wejścia [input_size + 1]
+    std::vector<uint32_t> block_column;  // Numer bloku neuronów (kolumna) każdego bloku
+    AlignedBuffer<T> block_weights;      // Wagi bloków [bloki x block]
+    AlignedBuffer<T> output_weights;     // Wagi wyjścia [output x paddedHidden()]
+    AlignedBuffer<T> hidden;             // Żywe neurony ukryte (z dopełnieniem do bloku)
+    std::vector<T> output;
+    std::vector<int> active_inputs;      // Indeksy zapalonych pikseli dla wejścia binarnego
+
+    int paddedHidden() const { return (static_cast<int>(neuron_ids.size()) + SPARSE_BLOCK - 1) / SPARSE_BLOCK * SPARSE_BLOCK; }
+
+    // hidden[kolumna bloku] += x * wagi bloku dla każdego niezerowego piksela x
+    template <int Width>
+    void accumulate(const T* inputs) {
+        // Najpierw indeksy niezerowych pikseli bez skoków warunkowych: na obrazach binarnych
+        // warunek x == 0 jest nieprzewidywalny i pomyłki predykcji kosztowały więcej niż same sumy
+        size_t active = 0;
+        for (int i = 0; i < input_size; ++i) {
+            active_inputs[active] = i;
+            active += inputs[i] != 0;
+        }
+        for (size_t a = 0; a < active; ++a) {
+            int i = active_inputs[a];
+            T x = inputs[i];
+            for (uint32_t b = row_start[i]; b < row_start[i + 1]; ++b) {
+                T* target = &hidden[static_cast<size_t>(block_column[b]) * Width];
+                const T* weights = &block_weights[static_cast<size_t>(b) * Width];
+                for (int k = 0; k < Width; ++k) {
+                    target[k] += x * weights[k];
+                }
+            }
+        }
+    }
+
+    template <int Width>
+    void accumulateBits(size_t active) {
+        for (size_t a = 0; a < active; ++a) {
+            int i = active_inputs[a];
+            for (uint32_t b = row_start[i]; b < row_start[i + 1]; ++b) {
+                T* target = &hidden[static_cast<size_t>(block_column[b]) * Width];
+                const T* weights = &block_weights[static_cast<size_t>(b) * Width];
+                for (int k = 0; k < Width; ++k) {
+                    target[k] += weights[k];
+                }
+            }
+        }
+    }
+
+    void allocateBuffers() {
+        hidden.assign(paddedHidden(), T(0));
+        output.assign(output_size, T(0));
+        active_inputs.assign(input_size, 0);
+    }
+
+    const std::vector<T>& computeOutput() {
+        const KernelTable<T>& kt = kernels<T>();
+        int padded = paddedHidden();
+        kt.relu(hidden.data(), padded);
+        for (int o = 0; o < output_size; ++o) {
+            output[o] = kt.dot(hidden.data(), &output_weights[static_cast<size_t>(o) * padded], padded);
+        }
+        if (output_activation == OUTPUT_SOFTMAX) {
+            softmaxRows(output.data(), 1, output_size);
+        } else {
+            for (T& value : output) {
+                value = T(1) / (T(1) + std::exp(-value));
+            }
+        }
+        return output;
+    }
+
+    template <typename U>
+    static void appendSection(std::vector<unsigned char>& body, const U* values, size_t count) {
+        body.resize(alignModelOffset(sizeof(SparseHeader) + body.size()) - sizeof(SparseHeader), 0);
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values);
+        body.insert(body.end(), bytes, bytes + count * sizeof(U));
+    }
+
+    template <typename U, typename Buffer>
+    static bool readSection(const unsigned char* body, size_t body_size, size_t& offset, Buffer& values, size_t count) {
+        offset = alignModelOffset(sizeof(SparseHeader) + offset) - sizeof(SparseHeader);
+        if (offset > body_size || count > (body_size - offset) / sizeof(U)) {
+            return false;
+        }
+        values.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            U value;
+            std::memcpy(&value, body + offset + i * sizeof(U), sizeof(U));
+            values[i] = static_cast<typename Buffer::value_type>(value);
+        }
+        offset += count * sizeof(U);
+        return true;
+    }
+
+    static bool readSection(const unsigned char* body, size_t body_size, size_t& offset, std::vector<uint32_t>& values, size_t count) {
+        return readSection<uint32_t>(body, body_size, offset, values, count);
+    }
+
+    static bool readWeights(const unsigned char* body, size_t body_size, size_t& offset, uint32_t dtype, AlignedBuffer<T>& values, size_t count) {
+        if (dtype == DTYPE_FLOAT64) {
+            return readSection<double>(body, body_size, offset, values, count);
+        }
+        return readSection<float>(body, body_size, offset, values, count);
+    }
+};
+
+// Porównuje sieć rzadką z gęstą na zbiorze data: zgodność wyników i czas forward na obraz
+template <typename T>
+void reportSparseSpeed(BasicNN<T>& nn, SparseNN<T>& sparse, const BasicDataset<T>& data) {
+    double max_delta = 0;
+    for (size_t s = 0; s < data.size(); ++s) {
+        std::vector<T> dense_result = nn.forward(data.sample(s));
+        const std::vector<T>& sparse_result = sparse.forward(data.sample(s));
+        for (int o = 0; o < nn.outputSize(); ++o) {
+            max_delta = std::max(max_delta, static_cast<double>(std::abs(dense_result[o] - sparse_result[o])));
+        }
+    }
+
+    // Co najmniej 0.2 s na każdą sieć, żeby pomiar nie zależał od rozdzielczości zegara
+    auto measure = [&](auto&& forward) {
+        size_t images = 0;
+        T checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        std::chrono::duration<double> elapsed(0);
+        while (elapsed.count() < 0.2) {
+            for (size_t s = 0; s < data.size(); ++s) {
+                checksum += forward(data.sample(s))[0];
+            }
+            images += data.size();
+            elapsed = std::chrono::steady_clock::now() - start;
+        }
+        volatile T sink = checksum;  // Wynik użyty, żeby kompilator nie pominął obliczeń
+        (void)sink;
+        return elapsed.count() * 1e6 / std::max<size_t>(1, images);
+    };
+    double dense_us = measure([&](const T* image) -> const std::vector<T>& { return nn.forward(image); });
+    double sparse_us = measure([&](const T* image) -> const std::vector<T>& { return sparse.forward(image); });
+
+    std::cout << "Sieć rzadka: " << sparse.liveHidden() << " z " << sparse.hiddenSize() << " neuronów ukrytych, "
+              << sparse.blockCount() << " bloków po " << sparse.blockSize() << " wag, " << sparse.weightBytes() << " B zamiast "
+              << nn.parameterCount() * sizeof(T) << " B" << std::endl;
+    std::cout << "Różnica wyników rzadka/gęsta: maks. " << max_delta << std::endl;
+    std::cout << "Forward: gęsta " << dense_us << " µs/obraz, rzadka " << sparse_us << " µs/obraz ("
+              << dense_us / std::max(sparse_us, 1e-9) << "x)" << std::endl;
+}
+
+#endif
@@ -0,0 +1,319 @@
+#ifndef XOCZY_TELEMETRY_H
+#define XOCZY_TELEMETRY_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Pomiary uczenia: czasy faz (forward, propagacja wsteczna, zmiana wag, epoka, odczyt plików)
+// i liczniki (błąd, trafność, próbki/s).
+//
+// Zdarzenia z dowolnych wątków trafiają do pierścienia bez blokad; osobny wątek co kilka
+// milisekund opróżnia go do pliku: CSV, JSON Lines albo Chrome trace (chrome://tracing, Perfetto).
+// Bez --trace pomiar to jedno sprawdzenie flagi na fazę. Kompilacja z -DXOCZY_TELEMETRY=0
+// usuwa pomiary całkowicie: makra TELEMETRY_* rozwijają się do niczego.
+
+#ifndef XOCZY_TELEMETRY
+#define XOCZY_TELEMETRY 1
+#endif
+
+enum TraceFormat {
+    TRACE_CHROME,  // {"traceEvents": [...]} dla chrome://tracing i Perfetto
+    TRACE_CSV,     // kind,name,thread,start_us,duration_us,value
+    TRACE_JSONL,   // jeden obiekt JSON na zdarzenie
+};
+
+enum TelemetryKind : uint8_t {
+    EVENT_SPAN,     // Faza z czasem trwania
+    EVENT_COUNTER,  // Wartość licznika w danej chwili
+};
+
+struct TelemetryEvent {
+    const char* name;   // Stała tekstowa (nie jest kopiowana)
+    int64_t start;      // ns zegara steady_clock
+    int64_t duration;   // ns, tylko dla EVENT_SPAN
+    double value;       // Tylko dla EVENT_COUNTER
+    uint32_t thread;
+    TelemetryKind kind;
+};
+
+inline int64_t telemetryNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Mały numer bieżącego wątku (kolejność pierwszego użycia), czytelniejszy w śladzie niż id systemowe
+inline uint32_t telemetryThread() {
+    static std::atomic<uint32_t> next_thread{0};
+    thread_local uint32_t thread = next_thread.fetch_add(1, std::memory_order_relaxed);
+    return thread;
+}
+
+// Pierścień zdarzeń o stałej pojemności: wielu piszących bez blokad, jeden czytający.
+// Piszący rezerwuje miejsce przez CAS na liczniku zapisu i publikuje je numerem sekwencji.
+// Gdy pierścień jest pełny, zdarzenie jest odrzucane (i liczone), a uczenie nigdy nie czeka.
+class TelemetryRing {
+public:
+    // Pojemność zaokrąglana w górę do potęgi dwójki
+    void reset(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        slots.reset(new Slot[size]);
+        mask = size - 1;
+        write_index.store(0);
+        read_index.store(0);
+        dropped_count.store(0);
+    }
+
+    bool push(const TelemetryEvent& event) {
+        uint64_t ticket = write_index.load(std::memory_order_relaxed);
+        do {
+            if (ticket - read_index.load(std::memory_order_acquire) > mask) {
+                dropped_count.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        } while (!write_index.compare_exchange_weak(ticket, ticket + 1, std::memory_order_relaxed));
+        Slot& slot = slots[ticket & mask];
+        slot.event = event;
+        slot.sequence.store(ticket + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Przekazuje consume wszystkie opublikowane zdarzenia; wołane tylko przez jeden wątek
+    template <typename Consume>
+    size_t drain(Consume consume) {
+        uint64_t position = read_index.load(std::memory_order_relaxed);
+        size_t count = 0;
+        while (true) {
+            Slot& slot = slots[position & mask];
+            if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+                break;
+            }
+            consume(slot.event);
+            read_index.store(++position, std::memory_order_release);
+            ++count;
+        }
+        return count;
+    }
+
+    uint64_t dropped() const { return dropped_count.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};  // Numer zapisu + 1, gdy zdarzenie jest gotowe
+        TelemetryEvent event;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    uint64_t mask = 0;
+    alignas(64) std::atomic<uint64_t> write_index{0};  // Osobne linie pamięci podręcznej dla piszących i czytającego
+    alignas(64) std::atomic<uint64_t> read_index{0};
+    std::atomic<uint64_t> dropped_count{0};
+};
+
+// Zapis zdarzeń do pliku i podsumowanie faz na koniec
+class Telemetry {
+public:
+    ~Telemetry() { finish(); }
+
+    bool enabled() const { return active.load(std::memory_order_relaxed); }
+
+    // Otwiera plik śladu i uruchamia wątek zapisujący
+    bool start(const std::string& path, TraceFormat trace_format, size_t capacity = 1 << 18) {
+#if !XOCZY_TELEMETRY
+        std::cerr << "Pomiary zostały wyłączone przy kompilacji (XOCZY_TELEMETRY=0)." << std::endl;
+        return false;
+#endif
+        file.open(path);
+        if (!file.is_open()) {
+            std::cerr << "Nie można zapisać śladu " << path << std::endl;
+            return false;
+        }
+        format = trace_format;
+        if (format == TRACE_CHROME) {
+            file << "{\"traceEvents\":[\n";
+        } else if (format == TRACE_CSV) {
+            file << "kind,name,thread,start_us,duration_us,value\n";
+        }
+        ring.reset(capacity);
+        origin = telemetryNow();
+        stopping = false;
+        active.store(true, std::memory_order_release);
+        writer = std::thread([this] { writeLoop(); });
+        return true;
+    }
+
+    void span(const char* name, int64_t start, int64_t end) {
+        ring.push({name, start, end - start, 0, telemetryThread(), EVENT_SPAN});
+    }
+
+    void counter(const char* name, double value) {
+        if (enabled()) {
+            ring.push({name, telemetryNow(), 0, value, telemetryThread(), EVENT_COUNTER});
+        }
+    }
+
+    // Zatrzymuje zapis, dopisuje resztę zdarzeń i wypisuje sumaryczne czasy faz
+    void finish() {
+        if (!writer.joinable()) {
+            return;
+        }
+        active.store(false, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        writer.join();
+        ring.drain([this](const TelemetryEvent& event) { write(event); });
+        if (format == TRACE_CHROME) {
+            file << "\n]}\n";
+        }
+        file.close();
+        printSummary();
+    }
+
+private:
+    struct PhaseTotal {
+        uint64_t calls = 0;
+        int64_t nanoseconds = 0;
+    };
+
+    std::atomic<bool> active{false};
+    TelemetryRing ring;
+    std::ofstream file;
+    TraceFormat format = TRACE_CHROME;
+    int64_t origin = 0;
+    bool first_event = true;
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::map<std::string, PhaseTotal> totals;  // Czytane i zmieniane tylko przez wątek zapisujący
+
+    void writeLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            wake.wait_for(lock, std::chrono::milliseconds(5));
+            ring.drain([this](const TelemetryEvent& event) { write(event); });
+        }
+    }
+
+    void write(const TelemetryEvent& event) {
+        double start_us = (event.start - origin) / 1000.0;
+        double duration_us = event.duration / 1000.0;
+        char line[256];
+        if (event.kind == EVENT_SPAN) {
+            PhaseTotal& total = totals[event.name];
+            ++total.calls;
+            total.nanoseconds += event.duration;
+        }
+
+        if (format == TRACE_CHROME) {
+            if (event.kind == EVENT_SPAN) {
+                std::snprintf(line, sizeof(line), "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                              event.name, event.thread, start_us, duration_us);
+            } else {
+                std::snprintf(line, sizeof(line), "{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%.9g}}",
+                              event.name, event.thread, start_us, event.value);
+            }
+            file << (first_event ? "" : ",\n") << line;
+        } else if (format == TRACE_CSV) {
+            std::snprintf(line, sizeof(line), "%s,%s,%u,%.3f,%.3f,%.9g\n", event.kind == EVENT_SPAN ? "span" : "counter",
+                          event.name, event.thread, start_us, duration_us, event.value);
+            file << line;
+        } else {
+            if (event.kind == EVENT_SPAN) {
+                std::snprintf(line, sizeof(line), "{\"kind\":\"span\",\"name\":\"%s\",\"thread\":%u,\"start_us\":%.3f,\"duration_us\":%.3f}\n",
+                              event.name, event.thread, start_us, duration_us);
+            } else {
+                std::snprintf(line, sizeof(line), "{\"kind\":\"counter\",\"name\":\"%s\",\"thread\":%u,\"start_us\":%.3f,\"value\":%.9g}\n",
+                              event.name, event.thread, start_us, event.value);
+            }
+            file << line;
+        }
+        first_event = false;
+    }
+
+    void printSummary() {
+        std::cout << "Czasy faz (suma ze wszystkich wątków):" << std::endl;
+        char line[128];
+        for (const auto& [name, total] : totals) {
+            std::snprintf(line, sizeof(line), "  %-16s %10llu wywołań %10.3f s %10.3f µs/wywołanie", name.c_str(),
+                          static_cast<unsigned long long>(total.calls), total.nanoseconds / 1e9,
+                          total.nanoseconds / 1e3 / total.calls);
+            std::cout << line << std::endl;
+        }
+        if (ring.dropped() > 0) {
+            std::cout << "Odrzucone zdarzenia (pełny bufor): " << ring.dropped() << std::endl;
+        }
+    }
+};
+
+inline Telemetry& telemetry() {
+    static Telemetry instance;
+    return instance;
+}
+
+// Mierzy czas od utworzenia do zniszczenia obiektu
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char* name) : name(name), start(telemetry().enabled() ? telemetryNow() : -1) {}
+
+    ~ScopedTimer() {
+        if (start >= 0) {
+            telemetry().span(name, start, telemetryNow());
+        }
+    }
+
+private:
+    const char* name;
+    int64_t start;
+};
+
+// Kolejne fazy jednej funkcji: next kończy bieżącą fazę i zaczyna następną
+class PhaseTimer {
+public:
+    explicit PhaseTimer(const char* name) : name(name), start(telemetry().enabled() ? telemetryNow() : -1) {}
+
+    ~PhaseTimer() { next(nullptr); }
+
+    void next(const char* next_name) {
+        if (start >= 0) {
+            int64_t now = telemetryNow();
+            telemetry().span(name, start, now);
+            start = now;
+        }
+        name = next_name;
+    }
+
+private:
+    const char* name;
+    int64_t start;
+};
+
+#if XOCZY_TELEMETRY
+#define TELEMETRY_CONCAT_(a, b) a##b
+#define TELEMETRY_CONCAT(a, b) TELEMETRY_CONCAT_(a, b)
+#define TELEMETRY_SCOPE(name) ScopedTimer TELEMETRY_CONCAT(telemetry_scope_, __LINE__)(name)
+#define TELEMETRY_PHASE(name) PhaseTimer telemetry_phase(name)
+#define TELEMETRY_NEXT_PHASE(name) telemetry_phase.next(name)
+#define TELEMETRY_COUNTER(name, value) telemetry().counter(name, value)
+#else
+#define TELEMETRY_SCOPE(name) ((void)0)
+#define TELEMETRY_PHASE(name) ((void)0)
+#define TELEMETRY_NEXT_PHASE(name) ((void)0)
+#define TELEMETRY_COUNTER(name, value) ((void)0)
+#endif
+
+#endif
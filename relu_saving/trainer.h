@@ -0,0 +1,184 @@
+#ifndef XOCZY_TRAINER_H
+#define XOCZY_TRAINER_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "dataset.h"
+#include "simple_nn.h"
+
+// Stała pula wątków wykonująca to samo zadanie na wszystkich wątkach naraz.
+// run() wraca dopiero, gdy każdy wątek skończy (bariera po każdym kroku).
+// Wątek wywołujący run() pracuje jako wątek nr 0, więc pula z 1 wątkiem nie tworzy żadnych wątków.
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads) : thread_count(std::max(1, threads)), generation(0), pending(0), stopping(false) {
+        for (int id = 1; id < thread_count; ++id) {
+            workers.emplace_back([this, id] { workerLoop(id); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Uruchamia job(id) na każdym wątku (id = 0..size()-1) i czeka na zakończenie wszystkich.
+    // Zadanie przekazywane jest przez wskaźnik, bez opakowania w std::function, więc run() nie alokuje pamięci.
+    template <typename Job>
+    void run(const Job& job) {
+        runJob([](const void* context, int id) { (*static_cast<const Job*>(context))(id); }, &job);
+    }
+
+    int size() const { return thread_count; }
+
+private:
+    int thread_count;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;  // Budzi wątki, gdy jest nowe zadanie
+    std::condition_variable done;  // Budzi run(), gdy wszystkie wątki skończyły
+    using JobFunction = void (*)(const void* context, int id);
+    JobFunction current_job = nullptr;  // Funkcja wywołująca bieżące zadanie
+    const void* current_context = nullptr;  // Obiekt zadania (lambda z run)
+    unsigned long generation;  // Numer kolejnego zadania, żeby wątek nie wykonał tego samego dwa razy
+    int pending;               // Ile wątków jeszcze pracuje nad bieżącym zadaniem
+    bool stopping;
+
+    void runJob(JobFunction job, const void* context) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current_job = job;
+            current_context = context;
+            pending = thread_count - 1;
+            ++generation;
+        }
+        wake.notify_all();
+        job(context, 0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return pending == 0; });
+        current_job = nullptr;
+        current_context = nullptr;
+    }
+
+    void workerLoop(int id) {
+        unsigned long seen = 0;
+        while (true) {
+            JobFunction job;
+            const void* context;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+                job = current_job;
+                context = current_context;
+            }
+            job(context, id);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--pending == 0) {
+                    done.notify_one();
+                }
+            }
+        }
+    }
+};
+
+// Równoległe uczenie z podziałem danych między wątki (data parallel).
+// Tryb synchroniczny: w każdym kroku każdy wątek liczy gradient swojej części kroku,
+// następnie gradienty są uśredniane po wszystkich próbkach kroku (każdy wątek redukuje swój zakres wag)
+// i nakładane raz, więc liczba wątków zmienia szybkość uczenia, ale nie wielkość kroku.
+// Tryb Hogwild: każdy wątek uczy się na własnym fragmencie zbioru i od razu zmienia wspólne wagi,
+// bez blokad. Zapisy wątków mogą się na siebie nakładać; przy rzadkich gradientach nie szkodzi to zbieżności.
+// Net to BasicNN albo LayerStack - każda sieć z computeGradients/applyGradients i typami Scalar, Gradients.
+template <typename Net>
+class ParallelTrainer {
+public:
+    using T = typename Net::Scalar;
+    using Gradients = typename Net::Gradients;
+
+    ParallelTrainer(Net& nn, int threads, bool hogwild = false)
+        : nn(nn), pool(threads), hogwild(hogwild), gradients(pool.size()) {
+        for (Gradients& grad : gradients) {
+            gradient_ptrs.push_back(&grad);
+        }
+    }
+
+    // Jedna epoka: każda próbka z data użyta raz. batch_size to liczba próbek na wątek w jednym kroku.
+    void trainEpoch(const BasicDataset<T>& data, int batch_size, T learning_rate) {
+        if (hogwild) {
+            trainEpochHogwild(data, batch_size, learning_rate);
+        } else {
+            trainEpochSynchronous(data, batch_size, learning_rate);
+        }
+    }
+
+    int threads() const { return pool.size(); }
+
+private:
+    Net& nn;
+    ThreadPool pool;
+    bool hogwild;
+    std::vector<Gradients> gradients;  // Osobne gradienty i bufory dla każdego wątku
+    std::vector<const Gradients*> gradient_ptrs;
+
+    void trainEpochSynchronous(const BasicDataset<T>& data, int batch_size, T learning_rate) {
+        size_t samples = data.size();
+        size_t step = static_cast<size_t>(batch_size) * pool.size();  // Próbki w jednym kroku wszystkich wątków
+        size_t parameters = nn.parameterCount();
+        int threads = pool.size();
+
+        for (size_t start = 0; start < samples; start += step) {
+            size_t step_size = std::min(step, samples - start);
+
+            // Faza 1: każdy wątek liczy gradient swojej części kroku
+            pool.run([&](int id) {
+                size_t begin = start + step_size * id / threads;
+                size_t end = start + step_size * (id + 1) / threads;
+                nn.computeGradients(data.sample(begin), data.label(begin), static_cast<int>(end - begin), gradients[id]);
+            });
+
+            // Faza 2: redukcja - każdy wątek uśrednia gradienty i zmienia wagi w swoim zakresie parametrów
+            nn.beginStep();
+            pool.run([&](int id) {
+                size_t begin = parameters * id / threads;
+                size_t end = parameters * (id + 1) / threads;
+                nn.applyGradients(gradient_ptrs.data(), threads, learning_rate, begin, end);
+            });
+        }
+    }
+
+    void trainEpochHogwild(const BasicDataset<T>& data, int batch_size, T learning_rate) {
+        size_t samples = data.size();
+        int threads = pool.size();
+
+        pool.run([&](int id) {
+            size_t shard_begin = samples * id / threads;
+            size_t shard_end = samples * (id + 1) / threads;
+            const Gradients* own[] = {&gradients[id]};
+            for (size_t i = shard_begin; i < shard_end; i += batch_size) {
+                int batch = static_cast<int>(std::min<size_t>(batch_size, shard_end - i));
+                nn.computeGradients(data.sample(i), data.label(i), batch, gradients[id]);
+                nn.applyGradients(own, 1, learning_rate, 0, nn.parameterCount());  // Bez blokad
+            }
+        });
+    }
+};
+
+#endif
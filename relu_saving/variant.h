@@ -0,0 +1,45 @@
+#ifndef XOCZY_VARIANT_H
+#define XOCZY_VARIANT_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "dataset.h"
+#include "image_file.h"
+#include "network.h"
+
+// Warianty simple i relu jako konfiguracje jednej sieci warstwowej (LayerStack) zamiast osobnych kopii kodu.
+// Jak pierwotne programy: uczenie próbka po próbce na training1-3.txt (X = 1, inne = 0) przez epochs epok,
+// potem wynik dla detection.txt. To samo daje xoczy --layers topology --activation activation --epochs epochs.
+inline int runVariant(const std::string& topology, const std::string& activation, int epochs) {
+    int input_size;
+    std::vector<LayerSpec> layers;
+    if (!parseTopology(topology, activation, input_size, layers)) {
+        return 1;
+    }
+    LayerStack<double> nn(input_size, layers);
+
+    Dataset data;
+    data.loadFiles({"training1.txt", "training2.txt", "training3.txt"}, {1, 0, 0});
+    if (data.size() == 0 || data.inputSize() != static_cast<size_t>(input_size)) {
+        std::cerr << "Brak obrazów treningowych o " << input_size << " pikselach." << std::endl;
+        return 1;
+    }
+    for (int epoch = 0; epoch < epochs; ++epoch) {
+        for (size_t i = 0; i < data.size(); ++i) {
+            nn.train(data.sample(i), data.label(i), 0.01);  // Uczy sieć z użyciem algorytmu backpropagation
+        }
+    }
+
+    std::vector<double> test_image = readImage("detection.txt", input_size);
+    if (test_image.size() != static_cast<size_t>(input_size)) {
+        std::cerr << "Obraz detection.txt nie ma " << input_size << " pikseli." << std::endl;
+        return 1;
+    }
+    // Wynik blisko 1 oznacza rozpoznanie wzoru, blisko 0 brak rozpoznania
+    std::cout << "Wynik: " << nn.forward(test_image)[0] << std::endl;
+    return 0;
+}
+
+#endif
@@ -4,199 +4,1010 @@
 #include <string>
 #include <cmath>
 #include <cstdlib>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <chrono>
+#include <thread>
 
-// Funkcja do odczytu obrazu z pliku tekstowego i normalizacji wartości pikseli (0 lub 1)
-std::vector<double> readImage(const std::string& filename) {
-    std::ifstream file(filename);  // Otwiera plik z obrazem
-    std::vector<double> image;     // Wektor przechowujący wartości pikseli
-    if (file.is_open()) {          // Sprawdza, czy plik został poprawnie otwarty
-        std::string line;
-        // Odczytuje każdą linię z pliku
-        while (std::getline(file, line)) {
-            for (char pixel : line) {
-                // Konwertuje znaki '0' i '1' na wartości 0.0 i 1.0, aby uzyskać normalizowane wartości pikseli
-                if (pixel == '0' || pixel == '1') {
-                    image.push_back((double)(pixel - '0'));  // Zamienia '0' lub '1' na double
-                }
-            }
+#include "batch_detect.h"
+#include "loader.h"
+#include "model_file.h"
+#include "network.h"
+#include "optimizer.h"
+#include "quantized.h"
+#include "scanner.h"
+#include "server.h"
+#include "simple_nn.h"
+#include "sparse.h"
+#include "telemetry.h"
+#include "trainer.h"
+
+// Zbiór syntetyczny do pomiarów: rzadkie losowe obrazy 10x10, żeby pomiar nie zależał od plików
+Dataset syntheticDataset(int samples, uint64_t seed) {
+    Xoshiro256 random(seed);
+    Dataset data;
+    for (int i = 0; i < samples; ++i) {
+        std::vector<double> image(100);
+        for (double& pixel : image) {
+            pixel = (random.next() % 5 == 0) ? 1.0 : 0.0;
         }
-        file.close();  // Zamknięcie pliku
+        data.add(image, {static_cast<double>(i % 2)});
     }
-    return image;  // Zwraca wektor pikseli (100 elementów, bo obraz ma rozmiar 10x10)
+    return data;
 }
 
-// Prosta sieć neuronowa z jedną warstwą ukrytą oraz funkcjami aktywacji ReLU i Sigmoid
-class SimpleNN {
-public:
-    // Konstruktor inicjalizujący sieć neuronową
-    SimpleNN(int input_size, int hidden_size, int output_size) {
-        // Inicjalizacja wektorów wag dla połączeń między warstwami
-        input_hidden_weights.resize(input_size * hidden_size);  // Wagi między warstwą wejściową a ukrytą
-        hidden_output_weights.resize(hidden_size * output_size); // Wagi między warstwą ukrytą a wyjściową
-        hidden_layer.resize(hidden_size);  // Warstwa ukryta (30 neuronów)
-        output_layer.resize(output_size);  // Warstwa wyjściowa (1 neuron)
+// Pomiar skalowania uczenia równoległego: epoki na sztucznym zbiorze dla 1, 2, 4, ... max_threads wątków
+// Każda liczba wątków zaczyna od tych samych wag (to samo ziarno), więc porównanie jest uczciwe.
+void runScalingBenchmark(const Dataset& data, int max_threads, bool hogwild, uint64_t seed) {
+    std::cout << "watki;probki/s;przyspieszenie" << std::endl;
+    double base = 0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        SimpleNN nn(100, 256, 1, seed);
+        ParallelTrainer trainer(nn, threads, hogwild);
+        const int epochs = 5;
+        trainer.trainEpoch(data, 32, 0.001);  // Rozgrzewka: przydział buforów wątków
 
-        // Inicjalizacja wag losowymi wartościami z zakresu [-1, 1]
-        for (double& weight : input_hidden_weights) {
-            weight = ((double) rand() / RAND_MAX) * 2 - 1;
+        auto start = std::chrono::steady_clock::now();
+        for (int epoch = 0; epoch < epochs; ++epoch) {
+            trainer.trainEpoch(data, 32, 0.001);
         }
-        for (double& weight : hidden_output_weights) {
-            weight = ((double) rand() / RAND_MAX) * 2 - 1;
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        double throughput = epochs * data.size() / elapsed.count();
+        if (threads == 1) {
+            base = throughput;
         }
+        std::cout << threads << ";" << throughput << ";" << throughput / base << std::endl;
     }
+}
 
-    // Funkcja forward propagation (przepływ sygnału od wejścia do wyjścia)
-    std::vector<double> forward(const std::vector<double>& inputs) {
-        // Obliczanie wartości neuronów w warstwie ukrytej
-        for (int i = 0; i < hidden_layer.size(); ++i) {
-            hidden_layer[i] = 0;
-            for (int j = 0; j < inputs.size(); ++j) {
-                hidden_layer[i] += inputs[j] * input_hidden_weights[i * inputs.size() + j]; // Suma ważona
-            }
-            hidden_layer[i] = relu(hidden_layer[i]);  // Aktywacja ReLU
-        }
+// Ustawienia programu z linii poleceń
+struct Options {
+    std::string dataset_path;  // Manifest albo katalog z danymi treningowymi (domyślnie training1-3.txt)
+    bool use_bits = false;     // --bits: wykrywanie na obrazie spakowanym w bity
+    bool use_float = false;    // --float: uczenie w pojedynczej precyzji
+    bool use_int8 = false;     // --int8: wykrywanie siecią int8 z model.int8 (z --convert: zapis modelu int8)
+    int batch_size = 1;        // --batch N: uczenie paczkami po N próbek
+    int threads = 1;           // --threads N: liczba wątków uczących
+    bool hogwild = false;      // --hogwild: wątki zmieniają wagi bez synchronizacji
+    int scaling = 0;           // --scaling N: pomiar przepustowości dla 1..N wątków
+    std::string convert_from;  // --convert WE WY: konwersja weights.txt do modelu binarnego
+    std::string convert_to;
+    std::string detect_path;   // --detect KATALOG|LISTA: wykrywanie wsadowe bez pytań
+    std::string stream_path;   // --stream PLIK: wykrywanie na połączonych obrazach ('-' = stdin)
+    DetectFormat format = FORMAT_CSV;  // --format csv|jsonl: format wyników wykrywania wsadowego
+    std::string output_path;   // --output PLIK: wyniki do pliku zamiast na stdout
+    bool serve = false;        // --serve: serwer wykrywania na stdin/stdout
+    std::string socket_path;   // --socket GNIAZDO: serwer wykrywania na gnieździe Unix
+    int latency_us = 1000;     // --latency-us N: ile najstarsze żądanie może czekać na pełną paczkę
+    std::string client_path;   // --client GNIAZDO: wysyła obrazy ze stdin do serwera
+    std::string loadgen_path;  // --loadgen GNIAZDO: generator obciążenia serwera
+    int requests = 10000;      // --requests N: liczba żądań generatora
+    int connections = 8;       // --connections N: liczba równoległych połączeń generatora
+    std::string layers;        // --layers 100-64-32-1: sieć o dowolnej liczbie warstw (LayerStack)
+    std::string activation = "relu";  // --activation relu|sigmoid: aktywacja warstw ukrytych LayerStack
+    std::string scan_path;     // --scan OBRAZ: wykrywanie oknem 10x10 na dużym obrazie ('-' = stdin)
+    std::string heatmap_path;  // --heatmap PLIK: mapa wyników skanowania (PGM)
+    double threshold = 0.5;    // --threshold X: próg trafienia przy skanowaniu
+    int band_rows = 64;        // --band N: wiersze wyników liczone w jednym pasie
+    uint64_t seed = DEFAULT_SEED;  // --seed N: ziarno inicjalizacji wag i danych syntetycznych
+    int progress = 0;          // --progress N: błąd, trafność i próbki/s co N epok
+    std::string trace_path;    // --trace PLIK: ślad faz uczenia i liczników
+    TraceFormat trace_format = TRACE_CHROME;  // --trace-format chrome|csv|jsonl
+    int epochs = 20000;        // --epochs N: najwięcej epok uczenia
+    double learning_rate = 0.01;  // --lr X: początkowy współczynnik uczenia
+    LearningRateSchedule schedule = SCHEDULE_CONSTANT;  // --lr-schedule constant|step|cosine
+    OptimizerSettings optimizer;  // --optimizer sgd|momentum|adam, --momentum X
+    std::string validation_path;  // --validation MANIFEST|KATALOG: osobny zbiór walidacyjny
+    double validation_split = 0;  // --validation-split F: ułamek zbioru treningowego odłożony do walidacji
+    int eval_every = 100;      // --eval-every K: sprawdzanie warunków zatrzymania co K epok
+    int patience = 10;         // --patience N: zatrzymanie po N sprawdzeniach bez poprawy (0 = wyłączone)
+    double min_improvement = 0.01;  // --min-improvement X: względny spadek błędu uznawany za poprawę
+    double target_loss = 0;    // --target-loss X: zatrzymanie po zejściu błędu do X (0 = wyłączone)
+    double target_accuracy = 0;  // --target-accuracy X: zatrzymanie po osiągnięciu trafności X (0-1)
+    AugmentSettings augment;   // --augment shift,flip,rotate,noise: uczenie na zmienionych kopiach obrazów
+    int loader_threads = 2;    // --loader-threads N: wątki przygotowujące porcje z augmentacją
+    int prefetch = 4;          // --prefetch N: liczba porcji w pierścieniu (bieżąca + przygotowywane)
+    int classes = 0;           // --classes K: klasyfikator K klas z softmaksem (etykiety to numery klas 0..K-1)
+    int top_k = 3;             // --top-k N: liczba najlepszych klas wypisywanych przy wykrywaniu
+    double prune = 0;          // --prune S: przycięcie ułamka S wag wejście->ukryta i zapis model.sparse
+    bool prune_idle = false;   // --prune-idle: przy przycinaniu usuwa też neurony nieaktywne na zbiorze treningowym
+    int fine_tune = 0;         // --fine-tune N: epoki dostrajania po przycięciu
+    bool use_sparse = false;   // --sparse: wykrywanie siecią rzadką z model.sparse
+};
 
-        // Obliczanie wartości neuronów w warstwie wyjściowej
-        for (int i = 0; i < output_layer.size(); ++i) {
-            output_layer[i] = 0;
-            for (int j = 0; j < hidden_layer.size(); ++j) {
-                output_layer[i] += hidden_layer[j] * hidden_output_weights[i * hidden_layer.size() + j]; // Suma ważona
+// Odczytuje argumenty; zwraca false przy błędnym argumencie
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        if (arg == "--bits") {
+            options.use_bits = true;
+        } else if (arg == "--float") {
+            options.use_float = true;
+        } else if (arg == "--int8") {
+            options.use_int8 = true;
+        } else if (arg == "--batch" && a + 1 < argc) {
+            options.batch_size = std::max(1, std::atoi(argv[++a]));
+        } else if (arg == "--threads" && a + 1 < argc) {
+            options.threads = std::atoi(argv[++a]);
+            if (options.threads <= 0) {
+                options.threads = std::max(1u, std::thread::hardware_concurrency());  // 0 = wszystkie rdzenie
+            }
+        } else if (arg == "--hogwild") {
+            options.hogwild = true;
+        } else if (arg == "--kernels" && a + 1 < argc) {
+            // Wymuszenie zestawu funkcji SIMD zamiast wykrytego przez CPUID
+            if (!selectKernels(argv[++a])) {
+                std::cerr << "Nieobsługiwany zestaw funkcji: " << argv[a] << std::endl;
+                return false;
+            }
+        } else if (arg == "--convert" && a + 2 < argc) {
+            options.convert_from = argv[++a];
+            options.convert_to = argv[++a];
+        } else if (arg == "--detect" && a + 1 < argc) {
+            options.detect_path = argv[++a];
+        } else if (arg == "--stream" && a + 1 < argc) {
+            options.stream_path = argv[++a];
+        } else if (arg == "--format" && a + 1 < argc) {
+            std::string format = argv[++a];
+            if (format == "csv") {
+                options.format = FORMAT_CSV;
+            } else if (format == "jsonl") {
+                options.format = FORMAT_JSONL;
+            } else {
+                std::cerr << "Nieobsługiwany format wyników: " << format << std::endl;
+                return false;
+            }
+        } else if (arg == "--output" && a + 1 < argc) {
+            options.output_path = argv[++a];
+        } else if (arg == "--serve") {
+            options.serve = true;
+        } else if (arg == "--socket" && a + 1 < argc) {
+            options.socket_path = argv[++a];
+        } else if (arg == "--latency-us" && a + 1 < argc) {
+            options.latency_us = std::max(0, std::atoi(argv[++a]));
+        } else if (arg == "--client" && a + 1 < argc) {
+            options.client_path = argv[++a];
+        } else if (arg == "--loadgen" && a + 1 < argc) {
+            options.loadgen_path = argv[++a];
+        } else if (arg == "--requests" && a + 1 < argc) {
+            options.requests = std::max(1, std::atoi(argv[++a]));
+        } else if (arg == "--connections" && a + 1 < argc) {
+            options.connections = std::max(1, std::atoi(argv[++a]));
+        } else if (arg == "--layers" && a + 1 < argc) {
+            options.layers = argv[++a];
+        } else if (arg == "--activation" && a + 1 < argc) {
+            options.activation = argv[++a];
+        } else if (arg == "--scan" && a + 1 < argc) {
+            options.scan_path = argv[++a];
+        } else if (arg == "--heatmap" && a + 1 < argc) {
+            options.heatmap_path = argv[++a];
+        } else if (arg == "--threshold" && a + 1 < argc) {
+            options.threshold = std::atof(argv[++a]);
+        } else if (arg == "--band" && a + 1 < argc) {
+            options.band_rows = std::max(1, std::atoi(argv[++a]));
+        } else if (arg == "--seed" && a + 1 < argc) {
+            options.seed = std::strtoull(argv[++a], nullptr, 10);
+        } else if (arg == "--progress" && a + 1 < argc) {
+            options.progress = std::max(0, std::atoi(argv[++a]));
+        } else if (arg == "--trace" && a + 1 < argc) {
+            options.trace_path = argv[++a];
+        } else if (arg == "--trace-format" && a + 1 < argc) {
+            std::string format = argv[++a];
+            if (format == "chrome") {
+                options.trace_format = TRACE_CHROME;
+            } else if (format == "csv") {
+                options.trace_format = TRACE_CSV;
+            } else if (format == "jsonl") {
+                options.trace_format = TRACE_JSONL;
+            } else {
+                std::cerr << "Nieobsługiwany format śladu: " << format << std::endl;
+                return false;
+            }
+        } else if (arg == "--epochs" && a + 1 < argc) {
+            options.epochs = std::max(1, std::atoi(argv[++a]));
+        } else if (arg == "--lr" && a + 1 < argc) {
+            options.learning_rate = std::atof(argv[++a]);
+        } else if (arg == "--lr-schedule" && a + 1 < argc) {
+            if (!parseSchedule(argv[++a], options.schedule)) {
+                std::cerr << "Nieobsługiwany harmonogram uczenia: " << argv[a] << std::endl;
+                return false;
             }
-            output_layer[i] = sigmoid(output_layer[i]);  // Aktywacja sigmoid
+        } else if (arg == "--optimizer" && a + 1 < argc) {
+            if (!parseOptimizer(argv[++a], options.optimizer.type)) {
+                std::cerr << "Nieobsługiwany optymalizator: " << argv[a] << std::endl;
+                return false;
+            }
+        } else if (arg == "--momentum" && a + 1 < argc) {
+            options.optimizer.momentum = std::atof(argv[++a]);
+        } else if (arg == "--validation" && a + 1 < argc) {
+            options.validation_path = argv[++a];
+        } else if (arg == "--validation-split" && a + 1 < argc) {
+            options.validation_split = std::atof(argv[++a]);
+        } else if (arg == "--eval-every" && a + 1 < argc) {
+            options.eval_every = std::max(1, std::atoi(argv[++a]));
+        } else if (arg == "--patience" && a + 1 < argc) {
+            options.patience = std::max(0, std::atoi(argv[++a]));
+        } else if (arg == "--min-improvement" && a + 1 < argc) {
+            options.min_improvement = std::max(0.0, std::atof(argv[++a]));
+        } else if (arg == "--augment" && a + 1 < argc) {
+            if (!parseAugment(argv[++a], options.augment)) {
+                return false;
+            }
+        } else if (arg == "--noise" && a + 1 < argc) {
+            options.augment.noise = std::atof(argv[++a]);
+        } else if (arg == "--max-shift" && a + 1 < argc) {
+            options.augment.max_shift = std::max(0, std::atoi(argv[++a]));
+        } else if (arg == "--loader-threads" && a + 1 < argc) {
+            options.loader_threads = std::max(1, std::atoi(argv[++a]));
+        } else if (arg == "--prefetch" && a + 1 < argc) {
+            options.prefetch = std::max(2, std::atoi(argv[++a]));
+        } else if (arg == "--target-loss" && a + 1 < argc) {
+            options.target_loss = std::atof(argv[++a]);
+        } else if (arg == "--target-accuracy" && a + 1 < argc) {
+            options.target_accuracy = std::atof(argv[++a]);
+        } else if (arg == "--classes" && a + 1 < argc) {
+            options.classes = std::atoi(argv[++a]);
+            if (options.classes < 2) {
+                std::cerr << "--classes wymaga co najmniej 2 klas." << std::endl;
+                return false;
+            }
+        } else if (arg == "--prune" && a + 1 < argc) {
+            options.prune = std::atof(argv[++a]);
+            if (options.prune <= 0 || options.prune >= 1) {
+                std::cerr << "--prune wymaga ułamka wag z przedziału (0, 1)." << std::endl;
+                return false;
+            }
+        } else if (arg == "--prune-idle") {
+            options.prune_idle = true;
+        } else if (arg == "--fine-tune" && a + 1 < argc) {
+            options.fine_tune = std::max(0, std::atoi(argv[++a]));
+        } else if (arg == "--sparse") {
+            options.use_sparse = true;
+        } else if (arg == "--top-k" && a + 1 < argc) {
+            options.top_k = std::max(1, std::atoi(argv[++a]));
+        } else if (arg == "--scaling" && a + 1 < argc) {
+            options.scaling = std::max(1, std::atoi(argv[++a]));
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            // Literówka w nazwie opcji albo opcja z wartością podana na końcu bez wartości
+            std::cerr << "Nieznana opcja albo brak jej wartości: " << arg << std::endl;
+            return false;
+        } else if (!options.dataset_path.empty()) {
+            std::cerr << "Podano więcej niż jeden zbiór treningowy: " << options.dataset_path << " i " << arg << std::endl;
+            return false;
+        } else {
+            options.dataset_path = arg;
         }
-
-        return output_layer;  // Zwraca wartości neuronów w warstwie wyjściowej
     }
+    if (options.classes > 0 && (!options.scan_path.empty() || options.serve || !options.socket_path.empty())) {
+        // Skaner i serwer zwracają jeden wynik detektora na okno albo obraz
+        std::cerr << "--scan i --serve działają tylko z siecią o jednym wyjściu (bez --classes)." << std::endl;
+        return false;
+    }
+    if (options.prune_idle && options.prune <= 0) {
+        std::cerr << "--prune-idle działa tylko z --prune." << std::endl;
+        return false;
+    }
+    if (options.use_int8 && (!options.scan_path.empty() || options.prune > 0 || options.use_sparse || options.use_bits)) {
+        // Skaner, przycinanie, sieć rzadka i wejście bitowe mają własne ścieżki liczenia bez int8
+        std::cerr << "--int8 nie działa z --scan, --prune, --sparse ani --bits." << std::endl;
+        return false;
+    }
+    if (options.hogwild && options.optimizer.type != OPTIMIZER_SGD) {
+        // Stan momentum/Adam zmieniany bez synchronizacji przez wiele wątków nie miałby sensu
+        std::cerr << "--hogwild działa tylko z --optimizer sgd." << std::endl;
+        return false;
+    }
+    if (!options.layers.empty()
+        && (!options.detect_path.empty() || !options.stream_path.empty() || !options.scan_path.empty() || options.serve
+            || !options.socket_path.empty() || !options.convert_from.empty() || options.prune > 0 || options.use_int8
+            || options.use_sparse || options.use_bits)) {
+        // Model binarny, wykrywanie wsadowe, serwer, int8 i przycinanie obsługują tylko sieć z jedną warstwą ukrytą
+        std::cerr << "--layers działa tylko z uczeniem i wykrywaniem detection.txt." << std::endl;
+        return false;
+    }
+    return true;
+}
 
-    // Funkcja uczenia sieci neuronowej (backpropagation)
-    void train(const std::vector<double>& inputs, const std::vector<double>& expected_output, double learning_rate) {
-        forward(inputs);  // Przeprowadza forward propagation na wejściu
+// Wczytuje zbiór treningowy raz, przed pętlą epok
+bool loadTrainingSet(const Options& options, Dataset& data) {
+    TELEMETRY_SCOPE("load_dataset");
+    data.setClasses(options.classes);
+    if (!options.dataset_path.empty()) {
+        // Manifest ("ścieżka etykieta" w każdej linii) albo katalog z podkatalogami-etykietami
+        data.load(options.dataset_path);
+    } else if (options.classes > 0) {
+        std::cerr << "--classes wymaga manifestu albo katalogu z numerami klas." << std::endl;
+        return false;
+    } else {
+        // Obrazy treningowe i oczekiwane wyniki dla sieci (1 dla X, 0 dla innych)
+        std::vector<std::string> training_files = {"training1.txt", "training2.txt", "training3.txt"};
+        std::vector<int> expected_outputs = {1, 0, 0};  // Trenuj sieć: X = 1, inne = 0
+        data.loadFiles(training_files, expected_outputs);
+    }
+    if (data.size() == 0 || data.inputSize() != 100) {
+        std::cerr << "Brak obrazów treningowych 10x10." << std::endl;
+        return false;
+    }
+    return true;
+}
 
-        // Obliczanie błędów dla warstwy wyjściowej
-        std::vector<double> output_error(output_layer.size());
-        for (int i = 0; i < output_layer.size(); ++i) {
-            output_error[i] = expected_output[i] - output_layer[i];  // Różnica między oczekiwanym a rzeczywistym wynikiem
+// Zbiór walidacyjny: wczytany z --validation albo odłożony z treningowego przez --validation-split.
+// Bez obu opcji zostaje pusty.
+bool loadValidationSet(const Options& options, Dataset& training, Dataset& validation) {
+    if (!options.validation_path.empty()) {
+        TELEMETRY_SCOPE("load_dataset");
+        validation.setClasses(options.classes);
+        validation.load(options.validation_path);
+        if (validation.size() == 0 || validation.inputSize() != training.inputSize()) {
+            std::cerr << "Brak obrazów walidacyjnych o rozmiarze obrazów treningowych." << std::endl;
+            return false;
         }
+    } else if (options.validation_split > 0) {
+        training.split(options.validation_split, options.seed, validation);
+    }
+    if (validation.size() > 0) {
+        std::cout << "Próbki treningowe: " << training.size() << ", walidacyjne: " << validation.size() << std::endl;
+    }
+    return true;
+}
 
-        // Obliczanie błędów dla warstwy ukrytej
-        std::vector<double> hidden_error(hidden_layer.size());
-        for (int i = 0; i < hidden_layer.size(); ++i) {
-            hidden_error[i] = 0;
-            for (int j = 0; j < output_layer.size(); ++j) {
-                hidden_error[i] += output_error[j] * hidden_output_weights[j * hidden_layer.size() + i];  // Błąd sumowany dla każdego wyjścia
+// Średni błąd (entropia krzyżowa) i odsetek poprawnych odpowiedzi (próg 0.5) na zbiorze.
+// Dla klasyfikatora (softmax) błąd to entropia krzyżowa kategorii, a odpowiedź jest poprawna,
+// gdy klasa o największym wyniku to klasa z etykiety.
+// Tylko forwardBatch paczkami po 256 próbek, bez liczenia gradientów.
+template <typename Net>
+void evaluateNetwork(Net& nn, const BasicDataset<typename Net::Scalar>& data, bool classifier, double& loss, double& accuracy) {
+    using T = typename Net::Scalar;
+    TELEMETRY_SCOPE("evaluate");
+    const size_t chunk = 256;
+    size_t outputs = data.labelSize();
+    std::vector<T> results(chunk * outputs);
+    size_t correct = 0;
+    loss = 0;
+    for (size_t start = 0; start < data.size(); start += chunk) {
+        size_t batch = std::min(chunk, data.size() - start);
+        nn.forwardBatch(data.sample(start), static_cast<int>(batch), results.data());
+        for (size_t b = 0; b < batch; ++b) {
+            const T* label = data.label(start + b);
+            const T* result = &results[b * outputs];
+            if (classifier) {
+                size_t expected = std::max_element(label, label + outputs) - label;
+                size_t predicted = std::max_element(result, result + outputs) - result;
+                loss -= std::log(std::max(static_cast<double>(result[expected]), 1e-12));
+                correct += expected == predicted;
+                continue;
             }
-            hidden_error[i] *= relu_derivative(hidden_layer[i]);  // Mnożenie przez pochodną ReLU
+            bool ok = true;
+            for (size_t j = 0; j < outputs; ++j) {
+                double p = std::min(std::max(static_cast<double>(results[b * outputs + j]), 1e-12), 1 - 1e-12);
+                loss -= label[j] * std::log(p) + (1 - label[j]) * std::log(1 - p);
+                ok = ok && ((p >= 0.5) == (label[j] >= 0.5));
+            }
+            correct += ok;
         }
+    }
+    loss /= data.size() * (classifier ? 1 : outputs);
+    accuracy = static_cast<double>(correct) / data.size();
+}
 
-        // Aktualizacja wag między warstwą ukrytą a wyjściową
-        for (int i = 0; i < hidden_output_weights.size(); ++i) {
-            hidden_output_weights[i] += learning_rate * output_error[i % output_layer.size()] * hidden_layer[i / output_layer.size()];
+// Trenowanie sieci (BasicNN albo LayerStack) przez najwyżej --epochs epok na obrazach trzymanych w pamięci.
+// Przy --progress albo --trace co N epok (domyślnie 1000 dla samego --trace) liczony jest błąd,
+// trafność i przepustowość; przy --progress są też wypisywane.
+//
+// Co --eval-every epok sprawdzane są warunki zatrzymania: na zbiorze walidacyjnym, a bez niego
+// na treningowym (wtedy tylko --target-loss i --target-accuracy). Każda poprawa błędu walidacji
+// zapisuje wagi do checkpoint; po zatrzymaniu sieć wraca do najlepszych zapisanych wag.
+// Z --augment każda epoka uczy na nowych, losowo zmienionych kopiach obrazów (AugmentedLoader).
+template <typename Net>
+bool trainNetwork(Net& nn, const BasicDataset<typename Net::Scalar>& data, const BasicDataset<typename Net::Scalar>& validation,
+                  const Options& options, const std::string& checkpoint) {
+    using T = typename Net::Scalar;
+    nn.setOptimizer(options.optimizer);
+    ParallelTrainer trainer(nn, options.threads, options.hogwild);
+    bool parallel = options.threads > 1 || options.hogwild;
+    bool per_sample = options.batch_size == 1 && options.optimizer.type == OPTIMIZER_SGD;  // Momentum i Adam wymagają applyGradients
+    int report_every = options.progress > 0 ? options.progress : (telemetry().enabled() ? 1000 : 0);
+    auto report_start = std::chrono::steady_clock::now();
+
+    bool validating = validation.size() > 0;
+    bool stopping = validating || options.target_loss > 0 || options.target_accuracy > 0;
+    const BasicDataset<T>& check_set = validating ? validation : data;
+    double best_loss = std::numeric_limits<double>::infinity();
+    double reference_loss = best_loss;  // Błąd przy ostatniej znaczącej poprawie
+    int best_epoch = 0;
+    int checked_epoch = 0;
+    int stale_checks = 0;
+
+    // Jedna epoka (albo jej porcja przy augmentacji) na próbkach part
+    auto trainPart = [&](const BasicDataset<T>& part, T learning_rate) {
+        if (parallel) {
+            trainer.trainEpoch(part, options.batch_size, learning_rate);  // Zbiór dzielony między wątki
+        } else if (per_sample) {
+            for (size_t i = 0; i < part.size(); ++i) {
+                nn.train(part.sample(i), part.label(i), learning_rate);  // Uczenie sieci (domyślnie learning rate 0.01)
+            }
+        } else {
+            // Kolejne wiersze Dataset leżą obok siebie, więc paczka to po prostu wskaźnik na pierwszy wiersz
+            for (size_t i = 0; i < part.size(); i += options.batch_size) {
+                int batch = std::min<size_t>(options.batch_size, part.size() - i);
+                nn.trainBatch(part.sample(i), part.label(i), batch, learning_rate);
+            }
         }
+    };
 
-        // Aktualizacja wag między wejściem a warstwą ukrytą
-        for (int i = 0; i < input_hidden_weights.size(); ++i) {
-            input_hidden_weights[i] += learning_rate * hidden_error[i % hidden_layer.size()] * inputs[i / hidden_layer.size()];
+    // Porcje to wielokrotność kroku wszystkich wątków, żeby podział na paczki był taki sam jak bez augmentacji
+    std::unique_ptr<AugmentedLoader<T>> loader;
+    if (options.augment.enabled()) {
+        if (!AugmentedLoader<T>::validInput(data)) {
+            std::cerr << "Augmentacja wymaga kwadratowych obrazów." << std::endl;
+            return false;
         }
+        size_t step = static_cast<size_t>(options.batch_size) * trainer.threads();
+        size_t chunk = step * ((256 + step - 1) / step);
+        loader = std::make_unique<AugmentedLoader<T>>(data, options.augment, chunk, options.loader_threads, options.prefetch, options.seed);
     }
 
-    // Funkcja zapisująca wagi do pliku
-    void saveWeights(const std::string& filename) {
-        std::ofstream file(filename);
-        if (file.is_open()) {
-            for (const double& weight : input_hidden_weights) {
-                file << weight << "\n";  // Zapis wag między wejściem a ukrytą warstwą
+    for (int epoch = 0; epoch < options.epochs; ++epoch) {
+        T learning_rate = static_cast<T>(scheduledLearningRate(options.schedule, options.learning_rate, epoch, options.epochs));
+        {
+            TELEMETRY_SCOPE("epoch");
+            if (!loader) {
+                trainPart(data, learning_rate);
+            } else {
+                // Epoka na zmienionych kopiach obrazów, przygotowywanych w tle porcjami
+                for (size_t c = 0; c < loader->chunksPerEpoch(); ++c) {
+                    trainPart(loader->next(), learning_rate);
+                    loader->release();
+                }
             }
-            for (const double& weight : hidden_output_weights) {
-                file << weight << "\n";  // Zapis wag między ukrytą a wyjściową warstwą
+        }
+        bool last = epoch + 1 == options.epochs;
+
+        if (report_every > 0 && ((epoch + 1) % report_every == 0 || last)) {
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - report_start;
+            int reported = (epoch % report_every) + 1;
+            double samples_per_second = reported * data.size() / elapsed.count();
+            double loss, accuracy;
+            evaluateNetwork(nn, data, options.classes > 0, loss, accuracy);
+            TELEMETRY_COUNTER("loss", loss);
+            TELEMETRY_COUNTER("accuracy", accuracy);
+            TELEMETRY_COUNTER("samples_per_sec", samples_per_second);
+            TELEMETRY_COUNTER("learning_rate", learning_rate);
+            if (options.progress > 0) {
+                std::cout << "Epoka " << epoch + 1 << ": błąd " << loss << ", trafność " << accuracy * 100
+                          << "%, " << static_cast<long long>(samples_per_second) << " próbek/s" << std::endl;
             }
-            file.close();
-        } else {
-            std::cerr << "Could not open file for writing." << std::endl;
+            report_start = std::chrono::steady_clock::now();  // Bez czasu oceny
         }
-    }
 
-    // Funkcja wczytująca wagi z pliku
-    void loadWeights(const std::string& filename) {
-        std::ifstream file(filename);
-        if (file.is_open()) {
-            for (double& weight : input_hidden_weights) {
-                file >> weight;  // Wczytywanie wag między wejściem a warstwą ukrytą
+        if (stopping && ((epoch + 1) % options.eval_every == 0 || last)) {
+            double loss, accuracy;
+            evaluateNetwork(nn, check_set, options.classes > 0, loss, accuracy);
+            checked_epoch = epoch + 1;
+            if (validating) {
+                TELEMETRY_COUNTER("val_loss", loss);
+                TELEMETRY_COUNTER("val_accuracy", accuracy);
+                if (options.progress > 0 && (epoch + 1) % options.progress == 0) {
+                    std::cout << "  walidacja: błąd " << loss << ", trafność " << accuracy * 100 << "%" << std::endl;
+                }
             }
-            for (double& weight : hidden_output_weights) {
-                file >> weight;  // Wczytywanie wag między ukrytą a wyjściową warstwą
+            if (loss < best_loss) {
+                best_loss = loss;
+                best_epoch = epoch + 1;
+                if (validating) {
+                    nn.saveWeights(checkpoint);
+                }
+            }
+            // Poprawa o mniej niż --min-improvement (względnie) nie odnawia cierpliwości
+            if (loss < reference_loss * (1 - options.min_improvement)) {
+                reference_loss = loss;
+                stale_checks = 0;
+            } else {
+                ++stale_checks;
             }
-            file.close();
+
+            const char* reason = nullptr;
+            if (options.target_loss > 0 && loss <= options.target_loss) {
+                reason = "osiągnięto docelowy błąd";
+            } else if (options.target_accuracy > 0 && accuracy >= options.target_accuracy) {
+                reason = "osiągnięto docelową trafność";
+            } else if (validating && options.patience > 0 && stale_checks >= options.patience) {
+                reason = "brak poprawy na zbiorze walidacyjnym";
+            }
+            if (reason != nullptr) {
+                std::cout << "Zatrzymano po epoce " << epoch + 1 << ": " << reason << " (błąd " << loss
+                          << ", trafność " << accuracy * 100 << "%)." << std::endl;
+                break;
+            }
+        }
+    }
+
+    if (validating && best_epoch > 0 && best_epoch != checked_epoch) {
+        if (nn.loadWeights(checkpoint)) {
+            std::cout << "Przywrócono wagi z epoki " << best_epoch << " (najmniejszy błąd walidacji " << best_loss << ")." << std::endl;
         } else {
-            std::cerr << "Could not open file for reading." << std::endl;
+            std::cerr << "Nie udało się przywrócić wag z " << checkpoint << "; zostają wagi z ostatniej epoki." << std::endl;
         }
     }
+    if (loader) {
+        std::cout << "Oczekiwanie na dane z augmentacją: " << loader->waitSeconds() << " s (" << loader->stallCount()
+                  << " przestojów)." << std::endl;
+    }
+    return true;
+}
+
+// Sieć z jednym wyjściem-detektorem albo klasyfikator --classes klas z softmaksem
+int outputCount(const Options& options) { return options.classes > 0 ? options.classes : 1; }
 
-private:
-    std::vector<double> input_hidden_weights;  // Wagi między warstwą wejściową a ukrytą
-    std::vector<double> hidden_output_weights;  // Wagi między warstwą ukrytą a wyjściową
-    std::vector<double> hidden_layer;  // Neurony w warstwie ukrytej
-    std::vector<double> output_layer;  // Neurony w warstwie wyjściowej
+OutputActivation outputActivation(const Options& options) { return options.classes > 0 ? OUTPUT_SOFTMAX : OUTPUT_SIGMOID; }
 
-    // Funkcja aktywacji sigmoid
-    double sigmoid(double x) {
-        return 1.0 / (1.0 + std::exp(-x));
+// Wynik dla obrazu detection.txt: wynik detektora albo --top-k najbardziej prawdopodobnych klas
+template <typename T>
+void printResult(const T* result, int outputs, const Options& options) {
+    if (options.classes == 0) {
+        std::cout << "Wynik: " << result[0] << std::endl;  // Powinien być bliski 1 dla X
+        return;
     }
+    std::vector<ClassScore> top(std::min(options.top_k, outputs));
+    selectTopK(result, outputs, static_cast<int>(top.size()), top.data());
+    for (const ClassScore& entry : top) {
+        std::cout << "Klasa " << entry.label << ": " << entry.score << std::endl;
+    }
+}
+
+// Wczytuje wytrenowane wagi: model binarny, a jeśli go nie ma - weights.txt.
+// Komunikat o źródle wag trafia do log (w trybie wsadowym stderr, żeby nie mieszać go z wynikami).
+// weights.txt nie zapisuje aktywacji wyjścia, więc wywołujący ustawia ją wcześniej (setOutputActivation).
+bool loadTrainedWeights(SimpleNN& nn, std::ostream& log) {
+    if (loadModel(nn, "model.xoczy")) {
+        log << "Wagi wczytane z model.xoczy." << std::endl;
+        return true;
+    }
+    if (nn.loadWeights("weights.txt")) {
+        log << "Wagi wczytane z weights.txt." << std::endl;
+        return true;
+    }
+    return false;
+}
+
+// Kwantyzacja do int8 ze skalami kalibrowanymi raz na zbiorze calibration (treningowym) i zapis modelu int8.
+// Wypisuje też zmianę trafności względem sieci w pełnej precyzji.
+template <typename T>
+bool saveQuantized(BasicNN<T>& nn, const Dataset& calibration, const std::string& filename) {
+    QuantizedNN quantized(nn, calibration);
+    reportQuantization(nn, quantized, calibration);
+    return quantized.save(filename);
+}
 
-    // Pochodna funkcji sigmoid (używana w backpropagation)
-    double sigmoid_derivative(double x) {
-        return x * (1.0 - x);
+// Wykrywanie wsadowe: model wczytany raz, obrazy z katalogu, listy albo strumienia liczone paczkami
+template <typename Net>
+int detectBatches(Net& nn, const Options& options) {
+    std::ofstream file;
+    if (!options.output_path.empty()) {
+        file.open(options.output_path);
+        if (!file.is_open()) {
+            std::cerr << "Nie można zapisać wyników do " << options.output_path << std::endl;
+            return 1;
+        }
     }
+    std::ostream& out = file.is_open() ? static_cast<std::ostream&>(file) : std::cout;
+
+    // --batch ustala też liczbę obrazów w jednym wywołaniu forwardBatch
+    const int batch_size = options.batch_size > 1 ? options.batch_size : 256;
+    BasicBatchDetector<Net> detector(nn, batch_size, options.format, out, options.top_k);
+    auto start = std::chrono::steady_clock::now();
 
-    // Funkcja aktywacji ReLU
-    double relu(double x) {
-        return x > 0 ? x : 0;
+    if (!options.detect_path.empty()) {
+        std::vector<std::string> images;
+        if (!collectImagePaths(options.detect_path, images)) {
+            return 1;
+        }
+        ImageFile file;
+        for (const std::string& image : images) {
+            if (file.open(image, nn.inputSize())) {
+                detector.add(image, file.view());  // Rozmiar sprawdzony przy otwarciu
+            } else {
+                detector.skip(image, file.error());
+            }
+        }
     }
+    if (options.stream_path == "-") {
+        detectStream(std::cin, "stdin", nn.inputSize(), detector);
+    } else if (!options.stream_path.empty()) {
+        std::ifstream stream(options.stream_path, std::ios::binary);
+        if (!stream.is_open()) {
+            std::cerr << "Nie można otworzyć strumienia " << options.stream_path << std::endl;
+            return 1;
+        }
+        detectStream(stream, options.stream_path, nn.inputSize(), detector);
+    }
+    detector.finish();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    reportDetectionSpeed(detector, elapsed.count());
+    return detector.skippedCount() == 0 ? 0 : 2;  // 2: część obrazów pominięta
+}
 
-    // Pochodna funkcji ReLU (używana w backpropagation)
-    double relu_derivative(double x) {
-        return x > 0 ? 1 : 0;
+int runBatchDetection(const Options& options) {
+    if (options.use_int8) {
+        QuantizedNN quantized;
+        if (!quantized.load("model.int8")) {
+            return 1;
+        }
+        std::cerr << "Sieć int8 wczytana z model.int8." << std::endl;
+        return detectBatches(quantized, options);
     }
-};
+    SimpleNN nn(100, 30, outputCount(options));
+    nn.setOutputActivation(outputActivation(options));  // Dla weights.txt; model.xoczy ma aktywację w nagłówku
+    if (!loadTrainedWeights(nn, std::cerr)) {
+        return 1;
+    }
+    return detectBatches(nn, options);
+}
 
-int main() {
-    // Inicjalizacja sieci neuronowej: 100 neuronów wejściowych, 30 ukrytych i 1 wyjściowy
+// Skanowanie dużego obrazu oknem sieci: trafienia jako CSV, opcjonalnie mapa wyników
+int runScan(const Options& options) {
     SimpleNN nn(100, 30, 1);
+    if (!loadTrainedWeights(nn, std::cerr)) {
+        return 1;
+    }
+    WindowScanner scanner(nn, options.threads);
+    if (!scanner.validNetwork(nn)) {
+        std::cerr << "Skanowanie wymaga sieci z kwadratowym wejściem i jednym wyjściem." << std::endl;
+        return 1;
+    }
+
+    std::ifstream file;
+    if (options.scan_path != "-") {
+        file.open(options.scan_path);
+        if (!file.is_open()) {
+            std::cerr << "Nie można otworzyć obrazu " << options.scan_path << std::endl;
+            return 1;
+        }
+    }
+    std::istream& in = file.is_open() ? static_cast<std::istream&>(file) : std::cin;
+
+    std::ofstream output;
+    if (!options.output_path.empty()) {
+        output.open(options.output_path);
+        if (!output.is_open()) {
+            std::cerr << "Nie można zapisać wyników do " << options.output_path << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& hits = output.is_open() ? static_cast<std::ostream&>(output) : std::cout;
+
+    ScanStats stats;
+    if (!scanner.scan(in, options.band_rows, options.threshold, hits, options.heatmap_path, stats)) {
+        return 1;
+    }
+    std::cerr << "Obraz " << stats.width << "x" << stats.height << ": " << stats.windows << " okien, "
+              << stats.hits << " trafień" << std::endl;
+    std::cerr << "Czas: " << stats.seconds << " s, " << stats.windows / std::max(stats.seconds, 1e-9) << " okien/s" << std::endl;
+    return 0;
+}
+
+// Przycinanie wytrenowanej sieci (--prune): wagi i zbiór treningowy wczytane raz, opcjonalne
+// dostrajanie (--fine-tune), zapis przyciętej sieci gęstej (weights-pruned.txt, model-pruned.xoczy)
+// i rzadkiej (model.sparse). Wagi pełnej sieci (weights.txt, model.xoczy) zostają nietknięte.
+int runPrune(const Options& options) {
+    SimpleNN nn(100, 30, outputCount(options), options.seed);
+    nn.setOutputActivation(outputActivation(options));
+    if (!loadTrainedWeights(nn, std::cout)) {
+        return 1;
+    }
+    Dataset data;
+    Dataset validation;
+    if (!loadTrainingSet(options, data) || !loadValidationSet(options, data, validation)) {
+        return 1;
+    }
+    const Dataset& check_set = validation.size() > 0 ? validation : data;
+    auto report = [&](const char* stage) {
+        double loss;
+        double accuracy;
+        evaluateNetwork(nn, check_set, options.classes > 0, loss, accuracy);
+        std::cout << stage << ": błąd " << loss << ", trafność " << 100 * accuracy << "%" << std::endl;
+    };
+
+    report("Przed przycięciem");
+    PruneReport pruned = pruneNetwork(nn, options.prune, data, options.prune_idle);
+    std::cout << "Przycięte wagi: " << pruned.magnitude_pruned << " najmniejszych, martwe neurony: " << pruned.dead_neurons
+              << " bez dodatnich wag";
+    if (options.prune_idle) {
+        std::cout << ", " << pruned.idle_neurons << " nieaktywne na zbiorze treningowym";
+    }
+    std::cout << std::endl;
+    std::cout << "Pozostałe wagi: " << pruned.kept_weights << " z " << nn.parameterCount() << std::endl;
+    report("Po przycięciu");
+    if (options.fine_tune > 0) {
+        Options tuning = options;
+        tuning.epochs = options.fine_tune;
+        if (!trainNetwork(nn, data, validation, tuning, "weights-pruned.txt")) {
+            return 1;
+        }
+        report("Po dostrojeniu");
+    }
+
+    nn.saveWeights("weights-pruned.txt");
+    saveModel(nn, "model-pruned.xoczy");
+    SparseNN<double> sparse(nn);
+    if (!sparse.save("model.sparse")) {
+        return 1;
+    }
+    std::cout << "Przycięta sieć zapisana do weights-pruned.txt, model-pruned.xoczy i model.sparse." << std::endl;
+    reportSparseSpeed(nn, sparse, data);
+    telemetry().finish();
+    return 0;
+}
+
+// Serwer wykrywania z modelem wczytanym raz; działa do końca stdin albo do SIGINT/SIGTERM (gniazdo)
+template <typename Net>
+int serveNetwork(Net& nn, const Options& options) {
+    // --batch ustala największą mikropaczkę
+    const int max_batch = options.batch_size > 1 ? options.batch_size : 64;
+    BasicMicroBatcher<Net> batcher(nn, max_batch, std::chrono::microseconds(options.latency_us));
+    if (!options.socket_path.empty()) {
+        if (!serveSocket(batcher, options.socket_path, nn.inputSize())) {
+            return 1;
+        }
+    } else {
+        serveStdin(batcher, nn.inputSize());
+    }
+    std::cerr << "Obrazy: " << batcher.requestCount() << ", paczki: " << batcher.batchCount() << std::endl;
+    return 0;
+}
+
+int runServer(const Options& options) {
+    if (options.use_int8) {
+        QuantizedNN quantized;
+        if (!quantized.load("model.int8")) {
+            return 1;
+        }
+        std::cerr << "Sieć int8 wczytana z model.int8." << std::endl;
+        return serveNetwork(quantized, options);
+    }
+    SimpleNN nn(100, 30, outputCount(options));
+    nn.setOutputActivation(outputActivation(options));
+    if (!loadTrainedWeights(nn, std::cerr)) {
+        return 1;
+    }
+    return serveNetwork(nn, options);
+}
+
+// Sieć o dowolnej liczbie warstw (--layers): uczenie albo wykrywanie na detection.txt.
+// Wagi każdej konfiguracji mają osobny plik, np. weights-100-64-32-1-relu.txt.
+template <typename T>
+int runLayerStack(const Options& options, bool training) {
+    int input_size;
+    std::vector<LayerSpec> specs;
+    if (!parseTopology(options.layers, options.activation, input_size, specs, options.classes > 0)) {
+        return 1;
+    }
+    LayerStack<T> nn(input_size, specs, options.seed);
+    if (options.classes > 0 && nn.outputSize() != options.classes) {
+        std::cerr << "Ostatnia warstwa --layers musi mieć " << options.classes << " wyjść (--classes)." << std::endl;
+        return 1;
+    }
+    std::string weights_file = "weights-" + options.layers + "-" + options.activation + ".txt";
+    std::cout << "Sieć: " << nn.describe() << std::endl;
+
+    if (training) {
+        Dataset data;
+        if (!loadTrainingSet(options, data)) {
+            return 1;
+        }
+        if (data.inputSize() != static_cast<size_t>(input_size)) {
+            std::cerr << "Sieć ma " << input_size << " wejść, a obrazy " << data.inputSize() << " pikseli." << std::endl;
+            return 1;
+        }
+        Dataset validation;
+        if (!loadValidationSet(options, data, validation)) {
+            return 1;
+        }
+        if (!trainNetwork(nn, data.template convert<T>(), validation.template convert<T>(), options, weights_file)) {
+            return 1;
+        }
+        nn.saveWeights(weights_file);
+        std::cout << "Sieć została wytrenowana i wagi zapisane do " << weights_file << "." << std::endl;
+        telemetry().finish();
+        return 0;
+    }
+
+    if (!nn.loadWeights(weights_file)) {
+        return 1;
+    }
+    std::vector<double> image = readImage("detection.txt", input_size);  // Odczyt obrazu testowego
+    if (image.size() != static_cast<size_t>(input_size)) {
+        std::cerr << "Obraz detection.txt nie ma " << input_size << " pikseli." << std::endl;
+        return 1;
+    }
+    std::vector<T> test_image(image.begin(), image.end());
+    std::vector<T> result = nn.forward(test_image);
+    printResult(result.data(), static_cast<int>(result.size()), options);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+    if (!options.trace_path.empty() && !telemetry().start(options.trace_path, options.trace_format)) {
+        return 1;
+    }
+
+    if (options.scaling > 0) {
+        std::cout << "Funkcje wektorowe: " << kernels().name << std::endl;
+        Dataset data = syntheticDataset(16384, options.seed);
+        runScalingBenchmark(data, options.scaling, options.hogwild, options.seed);
+        return 0;
+    }
+
+    if (!options.convert_from.empty() && options.use_int8) {
+        // Model int8: skale kalibrowane raz, tutaj, na zbiorze treningowym
+        SimpleNN nn(100, 30, outputCount(options));
+        nn.setOutputActivation(outputActivation(options));
+        Dataset calibration;
+        if (!nn.loadWeights(options.convert_from) || !loadTrainingSet(options, calibration)
+            || !saveQuantized(nn, calibration, options.convert_to)) {
+            return 1;
+        }
+        std::cout << "Zapisano model int8 " << options.convert_to << "." << std::endl;
+        return 0;
+    }
+    if (!options.convert_from.empty()) {
+        if (!convertWeights(options.convert_from, options.convert_to, 100, 30, outputCount(options), outputActivation(options))) {
+            return 1;
+        }
+        std::cout << "Zapisano model " << options.convert_to << "." << std::endl;
+        return 0;
+    }
+
+    if (options.prune > 0) {
+        return runPrune(options);
+    }
+
+    if (!options.detect_path.empty() || !options.stream_path.empty()) {
+        return runBatchDetection(options);
+    }
+
+    if (!options.scan_path.empty()) {
+        return runScan(options);
+    }
+
+    if (options.serve || !options.socket_path.empty()) {
+        return runServer(options);
+    }
+    if (!options.client_path.empty()) {
+        return runClient(options.client_path, 100) ? 0 : 1;
+    }
+    if (!options.loadgen_path.empty()) {
+        return runLoadGenerator(options.loadgen_path, 100, options.requests, options.connections) ? 0 : 1;
+    }
+
+    // Inicjalizacja sieci neuronowej: 100 neuronów wejściowych, 30 ukrytych i 1 wyjściowy (albo --classes)
+    SimpleNN nn(100, 30, outputCount(options), options.seed);
+    nn.setOutputActivation(outputActivation(options));
 
     std::cout << "Czy chcesz uczyć sieć? (1 - tak, 0 - nie): ";
     int choice;
     std::cin >> choice;
 
+    if (!options.layers.empty()) {
+        return options.use_float ? runLayerStack<float>(options, choice == 1) : runLayerStack<double>(options, choice == 1);
+    }
+
     if (choice == 1) {
-        // Obrazy treningowe i oczekiwane wyniki dla sieci (1 dla X, 0 dla innych)
-        std::vector<std::string> training_files = {"training1.txt", "training2.txt", "training3.txt"};
-        std::vector<int> expected_outputs = {1, 0, 0};  // Trenuj sieć: X = 1, inne = 0
+        Dataset data;
+        Dataset validation;
+        if (!loadTrainingSet(options, data) || !loadValidationSet(options, data, validation)) {
+            return 1;
+        }
 
-        // Trenowanie sieci przez 20 000 epok
-        for (int epoch = 0; epoch < 20000; ++epoch) {
-            for (int i = 0; i < training_files.size(); ++i) {
-                std::vector<double> image = readImage(training_files[i]);  // Odczyt obrazu
-                std::vector<double> expected_output = {static_cast<double>(expected_outputs[i])};  // Oczekiwany wynik
-                nn.train(image, expected_output, 0.01);  // Uczenie sieci z learning rate 0.01
+        if (options.use_float) {
+            // Uczenie w pojedynczej precyzji: dwa razy szersze wektory SIMD i połowa pamięci
+            BasicNN<float> nn_float(100, 30, outputCount(options), options.seed);
+            nn_float.setOutputActivation(outputActivation(options));
+            if (!trainNetwork(nn_float, data.convert<float>(), validation.convert<float>(), options, "weights.txt")) {
+                return 1;
+            }
+            nn_float.saveWeights("weights.txt");
+            saveModel(nn_float, "model.xoczy");
+            if (!saveQuantized(nn_float, data, "model.int8")) {
+                return 1;
+            }
+        } else {
+            if (!trainNetwork(nn, data, validation, options, "weights.txt")) {
+                return 1;
+            }
+            nn.saveWeights("weights.txt");
+            saveModel(nn, "model.xoczy");
+            if (!saveQuantized(nn, data, "model.int8")) {
+                return 1;
             }
         }
-
-        // Zapisz wagi do pliku
-        nn.saveWeights("weights.txt");
-        std::cout << "Sieć została wytrenowana i wagi zapisane do weights.txt." << std::endl;
+        std::cout << "Sieć została wytrenowana i wagi zapisane do weights.txt, model.xoczy i model.int8." << std::endl;
+        telemetry().finish();  // Dopisanie śladu i podsumowanie faz
 
     } else {
-        // Wczytaj wagi z pliku, jeśli sieć już była uczona
-        nn.loadWeights("weights.txt");
-        std::cout << "Wagi wczytane z weights.txt." << std::endl;
-
         // Testowanie sieci na nowym obrazie "detection.txt"
-        std::vector<double> test_image = readImage("detection.txt");  // Odczyt obrazu testowego
-        std::vector<double> result = nn.forward(test_image);  // Obliczenie wyniku sieci
+        std::vector<double> result;
+        MappedModel model;
+        bool plain = !options.use_bits && !options.use_int8 && !options.use_sparse;
+
+        if (options.use_sparse) {
+            // Sieć rzadka po --prune: tylko żywe neurony i niezerowe bloki wag
+            SparseNN<double> sparse;
+            if (!sparse.load("model.sparse")) {
+                return 1;
+            }
+            std::cout << "Sieć rzadka z model.sparse (" << sparse.liveHidden() << " z " << sparse.hiddenSize()
+                      << " neuronów ukrytych)." << std::endl;
+            size_t pixels = sparse.inputSize();
+            if (options.use_bits) {
+                BitImage test_image = readBitImage("detection.txt", pixels);  // Suma tylko po zapalonych pikselach
+                if (test_image.size() != pixels) {
+                    std::cerr << "Obraz detection.txt nie ma rozmiaru 10x10." << std::endl;
+                    return 1;
+                }
+                result = sparse.forward(test_image);
+            } else {
+                std::vector<double> test_image = readImage("detection.txt", pixels);
+                if (test_image.size() != pixels) {
+                    std::cerr << "Obraz detection.txt nie ma rozmiaru 10x10." << std::endl;
+                    return 1;
+                }
+                result = sparse.forward(test_image);
+            }
+        } else if (options.use_int8) {
+            // Sieć int8 ze skalami skalibrowanymi przy uczeniu (model.int8)
+            QuantizedNN quantized;
+            if (!quantized.load("model.int8")) {
+                return 1;
+            }
+            std::cout << "Sieć int8 wczytana z model.int8." << std::endl;
+            std::vector<double> test_image = readImage("detection.txt", quantized.inputSize());
+            if (test_image.size() != static_cast<size_t>(quantized.inputSize())) {
+                std::cerr << "Obraz detection.txt nie ma rozmiaru 10x10." << std::endl;
+                return 1;
+            }
+            result = quantized.forward(test_image);
+        } else if (plain && model.open("model.xoczy")) {
+            // Model binarny: wagi czytane wprost ze zmapowanego pliku, bez parsowania
+            std::cout << "Model zmapowany z model.xoczy." << std::endl;
+            std::vector<double> test_image = readImage("detection.txt", model.info().input_size);  // Odczyt obrazu testowego
+            if (test_image.size() != model.info().input_size) {
+                std::cerr << "Obraz detection.txt nie ma rozmiaru 10x10." << std::endl;
+                return 1;
+            }
+            result = model.forward(test_image);
+        } else {
+            // Wczytaj wagi z pliku, jeśli sieć już była uczona
+            if (!loadTrainedWeights(nn, std::cout)) {
+                return 1;
+            }
 
-        // Wyświetlenie wyniku (powinien być bliski 1 dla X)
-        std::cout << "Wynik: " << result[0] << std::endl;
+            if (options.use_bits) {
+                BitImage test_image = readBitImage("detection.txt", 100);  // Odczyt obrazu testowego jako bity
+                if (test_image.size() != 100) {
+                    std::cerr << "Obraz detection.txt nie ma rozmiaru 10x10." << std::endl;
+                    return 1;
+                }
+                result = nn.forward(test_image);  // Suma tylko po zapalonych pikselach
+            } else {
+                std::vector<double> test_image = readImage("detection.txt", 100);  // Odczyt obrazu testowego
+                if (test_image.size() != 100) {
+                    std::cerr << "Obraz detection.txt nie ma rozmiaru 10x10." << std::endl;
+                    return 1;
+                }
+                result = nn.forward(test_image);  // Obliczenie wyniku sieci
+            }
+        }
+
+        printResult(result.data(), static_cast<int>(result.size()), options);
     }
 
     return 0;
 }
-